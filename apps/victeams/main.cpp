@@ -11,8 +11,6 @@
 
 using namespace dynamo;
 
-struct act {};
-
 class SimpleReasonner : public FlowBuilder
 {
 public:
@@ -28,7 +26,8 @@ public:
 		);
 		perception.name("Perception");
 
-		auto feasible = process<strat::ContainerAccumulator, std::vector<flecs::entity>>();
+		// Only depends on the actions available in the world, shared by all agents.
+		auto feasible = process<strat::SpanAccumulator, std::vector<flecs::entity>>(Memoized{});
 		feasible.name("FeasibleActions");
 		feasible.succeed(perception);
 
@@ -74,14 +73,15 @@ int main(int argc, char** argv) {
 	sim.world().import<module::BasicAction>();
 	sim.world().import<module::ADL>();
 
-	sim.world().component<act>().add(flecs::Exclusive);
-
 	sim.world().type<State>()
 		.add<State::Well>()
         .add<State::Unwell>();
 
 	auto root = sim.world().entity("Root").add<type::Root>();
 
+	catalog<Idle>(sim.world());
+	catalog<Work>(sim.world());
+
 	sim.action("Do nothing")
 		.add<Idle>()
 		.set<Cost>({ 0 });
@@ -140,7 +140,8 @@ int main(int argc, char** argv) {
 	//			std::cout << "- PVA status :" << std::endl;
 	//			for (auto i : iter)
 	//			{
-	//				iter.entity(i).each<const act>([](flecs::entity action) { std::cout << action.name() << " "; });
+	//				if (auto current = iter.entity(i).get<CurrentAction>(); current && current->action)
+	//					std::cout << iter.world().entity(current->action).name() << " ";
 	//			}
 	//		}
 	//);
@@ -156,44 +157,28 @@ int main(int argc, char** argv) {
 
  //   sim.world().system<Result>("Logging")
 	//	.each([](flecs::entity e, Result& result) {
-	//			e.each<const act>([&result](flecs::entity action) { result.ss << action.name() << ";"; });
+	//			if (auto current = e.get<CurrentAction>(); current && current->action)
+	//				result.ss << e.world().entity(current->action).name() << ";";
  //       });
 
-	//sim.world().observer<const act>()
-	//	.arg(1).obj(flecs::Wildcard)
-	//	.event(flecs::OnAdd)
-	//	.iter([](flecs::iter& iter, const act * _) {
-	//			for (auto i : iter)
-	//			{
-	//				std::cout << iter.entity(i).name() << " is doing  ";
-	//				iter.entity(i).each<const act>([](flecs::entity action) { std::cout << action.name() << "\n"; });
-	//			}
+	//sim.world().observer<const CurrentAction>()
+	//	.event(flecs::OnSet)
+	//	.each([](flecs::entity e, const CurrentAction& current) {
+	//			if (current.action)
+	//				std::cout << e.name() << " is doing  " << e.world().entity(current.action).name() << "\n";
 	//		});
 
 
-    sim.strategy<strat::ContainerAccumulator<std::vector<flecs::entity>>>()
+    sim.strategy<strat::SpanAccumulator<std::vector<flecs::entity>>>()
         .behaviour(
             "Work",
             [](AgentHandle agent) {return true; },
-            [](AgentHandle agent)
-			{
-				std::vector<flecs::entity> actions;
-				agent.entity().world().each<const Work>([&agent, &actions](flecs::entity e, const Work _) {
-					actions.push_back(e);
-					});
-				return actions;
-			}
+            [](AgentHandle agent) { return actions<Work>(agent.entity().world()); }
         )
         .behaviour(
             "Idle",
             [](AgentHandle agent) {return true; },
-            [](AgentHandle agent) {
-				std::vector<flecs::entity> actions;
-				agent.entity().world().each<const Idle>([&agent, &actions](flecs::entity e, const Idle _) {
-					actions.push_back(e);
-					});
-				return actions;
-			}
+            [](AgentHandle agent) { return actions<Idle>(agent.entity().world()); }
         );
 
 			flecs::world newone;
@@ -219,7 +204,9 @@ int main(int argc, char** argv) {
 	        [](AgentHandle agent) -> bool {return true; },
 	        [](AgentHandle agent, flecs::entity arg)
 			{
-				agent.add<act>(arg);
+				// Cooperative actions are assigned by the ADL allocation stage, see CurrentAction.
+				[[maybe_unused]] const bool proposed = propose(agent.entity(), arg);
+				assert((proposed || !arg) && "Import module::ADL to allocate actions.");
 				return arg;
 			}
 	);
@@ -1,5 +1,12 @@
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
 #include <benchmark/benchmark.h>
 #include <dynamo/simulation.hpp>
+#include <dynamo/modules/messaging.hpp>
+#include <dynamo/modules/activity_dl.hpp>
+#include <dynamo/modules/basic_stress.hpp>
 
 const size_t repetitions_count = 10;
 
@@ -71,5 +78,256 @@ BENCHMARK(BM_create_percept)
         ->Repetitions(repetitions_count)->DisplayAggregatesOnly()
 ;
 
+static void BM_publish_to_organisation(benchmark::State& state) {
+    auto sim = dynamo::Simulation();
+    sim.world().import<dynamo::module::Messaging>();
+    auto team = sim.world().entity("Team").add<dynamo::type::Organisation>();
+    std::vector<flecs::entity> members{};
+    for(int i = 0; i<state.range(0); i++){
+        auto agent = sim.agent().entity();
+        agent.set<dynamo::Mailbox>(dynamo::Mailbox(1024)).add<dynamo::belongs_to>(team);
+        members.push_back(agent);
+    }
+    sim.step();
+    auto payload = dynamo::Payload::intern("Status report");
+    const size_t batch = 512;
+    for ([[maybe_unused]] auto _ : state) {
+        for(size_t i = 0; i<batch; i++){
+            dynamo::publish(members[i % members.size()], team, payload);
+        }
+        for(auto member : members){
+            dynamo::receive(member, [](dynamo::Envelope&& envelope) { benchmark::DoNotOptimize(envelope); });
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * batch * state.range(0));
+}
+BENCHMARK(BM_publish_to_organisation)
+        ->Unit(benchmark::kMicrosecond)
+        ->RangeMultiplier(4)->Range(1<<2, 1<<8)
+;
+
+static void BM_mailbox_mpsc(benchmark::State& state) {
+    static dynamo::MailboxQueue* queue = nullptr;
+    static std::atomic<bool> running{ false };
+    static std::thread consumer{};
+    if(state.thread_index() == 0){
+        queue = new dynamo::MailboxQueue(1<<16);
+        running = true;
+        consumer = std::thread([]() {
+            while(running.load(std::memory_order_relaxed)){
+                queue->drain([](dynamo::Envelope&& envelope) { benchmark::DoNotOptimize(envelope); });
+            }
+        });
+    }
+    auto payload = dynamo::Payload::intern("Status report");
+    for ([[maybe_unused]] auto _ : state) {
+        while(!queue->try_push({ 0, 0, payload })){}
+    }
+    if(state.thread_index() == 0){
+        running = false;
+        consumer.join();
+        delete queue;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_mailbox_mpsc)
+        ->ThreadRange(1, 8)->UseRealTime()
+;
+
+static void BM_adl_feasibility(benchmark::State& state) {
+    const size_t number_of_agents = state.range(0);
+    const size_t number_of_actions = state.range(1);
+
+    dynamo::FeasibilityMatrix matrix{};
+    matrix.preconditions.resize(number_of_actions);
+    for(size_t i = 0; i<number_of_actions; i++){
+        matrix.required.push_back(static_cast<int>(i * 10 / number_of_actions));
+        matrix.arity.push_back(1);
+        matrix.preconditions.set(i, i % 7 != 0);
+    }
+    std::vector<int> qualifications(number_of_agents);
+    for(size_t i = 0; i<number_of_agents; i++){
+        qualifications[i] = static_cast<int>(i % 10);
+    }
+    std::vector<dynamo::DynamicBitset> feasible(number_of_agents, dynamo::DynamicBitset(number_of_actions));
+
+    for ([[maybe_unused]] auto _ : state) {
+        for(size_t i = 0; i<number_of_agents; i++){
+            matrix.evaluate(qualifications[i], feasible[i]);
+        }
+        benchmark::DoNotOptimize(feasible.data());
+    }
+    state.SetItemsProcessed(state.iterations() * number_of_agents * number_of_actions);
+}
+BENCHMARK(BM_adl_feasibility)
+        ->Unit(benchmark::kMicrosecond)
+        ->Args({1000, 100})->Args({10000, 1000})
+;
+
+static void BM_adl_allocation(benchmark::State& state) {
+    const size_t number_of_agents = state.range(0);
+    const size_t number_of_actions = state.range(1);
+    const size_t proposals_per_agent = 4;
+
+    dynamo::AllocationSolver solver{};
+    for ([[maybe_unused]] auto _ : state) {
+        solver.clear();
+        for(size_t i = 0; i<number_of_agents; i++){
+            auto agent = solver.agent(i);
+            for(size_t k = 0; k<proposals_per_agent; k++){
+                const size_t j = (i * 7 + k * 13) % number_of_actions;
+                auto action = solver.action(number_of_agents + j, 1 + static_cast<int>(j % 3));
+                solver.propose(agent, action, static_cast<float>((i + k) % 17));
+            }
+        }
+        solver.solve();
+        benchmark::DoNotOptimize(solver.assignment(0));
+    }
+    state.SetItemsProcessed(state.iterations() * number_of_agents * proposals_per_agent);
+}
+BENCHMARK(BM_adl_allocation)
+        ->Unit(benchmark::kMicrosecond)
+        ->Args({100, 50})->Args({1000, 500})
+;
+
+static void BM_stress_dynamics(benchmark::State& state) {
+    const size_t number_of_agents = state.range(0);
+
+    flecs::world world{};
+    world.import<dynamo::module::BasicStress>();
+    for(size_t i = 0; i<number_of_agents; i++){
+        world.entity().add<dynamo::type::Agent>().set<dynamo::Stress>({ static_cast<float>(i % 100) });
+    }
+
+    for ([[maybe_unused]] auto _ : state) {
+        world.progress(0.01f);
+    }
+    state.SetItemsProcessed(state.iterations() * number_of_agents);
+}
+BENCHMARK(BM_stress_dynamics)
+        ->Unit(benchmark::kMillisecond)
+        ->Arg(1000000)
+;
+
+struct Load { float value {100.f}; };
+
+class BusyFlow : public dynamo::FlowBuilder
+{
+public:
+    using FlowBuilder::FlowBuilder;
+
+    virtual constexpr const char* name() const { return "BusyFlow"; }
+
+    void build() override
+    {
+        emplace([](dynamo::AgentHandle agent) {
+            float sum = 0.f;
+            for(int i = 0; i < 10000; i++){
+                sum += static_cast<float>(i);
+            }
+            benchmark::DoNotOptimize(sum);
+        });
+    }
+};
+
+// Arg 0 : dynamics run by a multi-threaded system on flecs worker stages during progress, then flows (two phases).
+// Arg 1 : dynamics run as a job on the executor, alongside flows.
+static void BM_step_jobs_and_flows(benchmark::State& state) {
+    const bool unified = state.range(0) != 0;
+    const size_t number_of_agents = 1000;
+    const size_t number_of_loads = 1000000;
+    const auto relaxation = dynamo::dynamics::Relaxation{ 0.f, 0.1f };
+
+    auto sim = dynamo::Simulation();
+    if (unified) {
+        dynamo::integrate<Load>(sim.world(), relaxation, "Load", true);
+    }
+    else {
+        sim.world().system<Load>("Load")
+            .multi_threaded(true)
+            .iter([relaxation](flecs::iter& it, Load* load) {
+                dynamo::kernel::integrate<&Load::value>(load, it.count(), it.delta_time(), relaxation);
+            });
+    }
+
+    sim.flow<BusyFlow>();
+    auto archetype = sim.agent_archetype("Busy");
+    archetype.flow<BusyFlow>({ true, 0.f });
+    for(size_t i = 0; i<number_of_agents; i++){
+        sim.agent(archetype);
+    }
+    for(size_t i = 0; i<number_of_loads; i++){
+        sim.world().entity().set<Load>({});
+    }
+    sim.step(0.01f);
+
+    for ([[maybe_unused]] auto _ : state) {
+        sim.step(0.01f);
+    }
+    sim.shutdown();
+}
+BENCHMARK(BM_step_jobs_and_flows)
+        ->Unit(benchmark::kMillisecond)
+        ->Arg(0)->Arg(1)
+;
+
+template<int Work>
+class SpinFlow : public dynamo::FlowBuilder
+{
+public:
+    using FlowBuilder::FlowBuilder;
+
+    virtual constexpr const char* name() const { return "SpinFlow"; }
+
+    void build() override
+    {
+        emplace([](dynamo::AgentHandle agent) {
+            float sum = 0.f;
+            for(int i = 0; i < Work; i++){
+                sum += static_cast<float>(i);
+            }
+            benchmark::DoNotOptimize(sum);
+        });
+    }
+};
+
+using LightFlow = SpinFlow<10000>;
+using HeavyFlow = SpinFlow<2000000>;
+
+// Many light flows, launched first, and one heavy flow per worker, launched last.
+// Arg 0 : flows are launched in order. Arg 1 : longest critical path first.
+static void BM_step_makespan(benchmark::State& state) {
+    const bool critical_path = state.range(0) != 0;
+    const size_t number_of_workers = std::max(1u, std::thread::hardware_concurrency() - 1);
+
+    auto sim = dynamo::Simulation(number_of_workers);
+    sim.critical_path_scheduling(critical_path);
+    sim.flow<LightFlow>();
+    sim.flow<HeavyFlow>();
+    auto light = sim.agent_archetype("Light");
+    light.flow<LightFlow>({ true, 0.f });
+    auto heavy = sim.agent_archetype("Heavy");
+    heavy.flow<HeavyFlow>({ true, 0.f });
+    for(size_t i = 0; i < 100 * number_of_workers; i++){
+        sim.agent(light);
+    }
+    for(size_t i = 0; i < number_of_workers; i++){
+        sim.agent(heavy);
+    }
+    sim.step_n(3, 0.01f); // Durations are measured
+
+    double makespan = 0.;
+    for ([[maybe_unused]] auto _ : state) {
+        sim.step(0.01f);
+        makespan += sim.timings().flows.count();
+    }
+    state.counters["makespan_ms"] = benchmark::Counter(makespan, benchmark::Counter::kAvgIterations);
+    sim.shutdown();
+}
+BENCHMARK(BM_step_makespan)
+        ->Unit(benchmark::kMillisecond)
+        ->Arg(0)->Arg(1)
+;
+
 // Run the benchmark
 BENCHMARK_MAIN();
\ No newline at end of file
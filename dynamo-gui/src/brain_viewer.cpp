@@ -40,7 +40,7 @@ void dynamo::widgets::BrainViewer::render_graph() const
             }
             else
             {
-                if (active_tasks.contains(hash))
+                if (active_tasks.contains(_details->executed_task(hash))) // Tasks may have been fused
                 {
                     ImNodes::PushColorStyle(ImNodesCol_TitleBar, ImGui::Color::GREEN_n);
                     ImNodes::PushColorStyle(ImNodesCol_TitleBarHovered, ImGui::Color::GREEN_h);
@@ -119,7 +119,12 @@ void dynamo::widgets::BrainViewer::build() {
                     layout_graph.newEdge(imnodes_ogdf_nodes.at(source), target);
 
                     ImGui::Flow::Pin* source_flow_pin = nullptr;
-                    if (source->output_pins.size() == 0)
+                    if (_details->find(hash).type() == ProcessType::Conditional)
+                    {
+                        // One pin per branch, named after it.
+                        source_flow_pin = &source->output_pin(im_target->name);
+                    }
+                    else if (source->output_pins.size() == 0)
                     {
                         source_flow_pin = &source->output_pin("");
                     }
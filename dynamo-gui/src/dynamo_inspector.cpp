@@ -32,7 +32,8 @@ namespace dynamo{
                 auto parent = e.get_object(flecs::ChildOf);
                 if (parent.has(flecs::Prefab))
                     return;
-                e.set<type::BrainViewer>({ e, handle.taskflow, e.get<type::ProcessDetails>() });
+                auto details = e.get<type::ProcessDetails>();
+                e.set<type::BrainViewer>({ e, details->graph.get(), details }); // Show the logical graph, not the fused one
             });
 
         world.observer<type::IGOutput<int>>("OnSet_IGOutput_AddViewer")
@@ -168,6 +168,10 @@ namespace dynamo::widgets {
                                     auto process = process_details->find(current_viewer->find_task(node));
                                     ImGui::Text("Node : %s", node->name);
                                     ImGui::Text("Type : %s", to_string(process.type()));
+                                    if (process.type() == ProcessType::Conditional)
+                                        ImGui::Text("Branches : %zu", process.branches().size());
+                                    if (auto module = process.module())
+                                        ImGui::Text("Module : %s", module->name());
                                 }
                             }
                         }
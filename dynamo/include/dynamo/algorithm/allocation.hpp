@@ -0,0 +1,182 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+
+namespace dynamo
+{
+    /**
+    @class AllocationSolver
+
+    @brief Assign agents to actions, once for all agents, from scored proposals stored in flat arrays.
+
+    An action with an arity greater than 1 is cooperative : it must be executed by exactly @c arity agents.
+    Other actions can be executed by any number of agents.
+
+    The solver is greedy : proposals are taken by decreasing score, each agent gets at most one action and a
+    cooperative action is taken until it is fully staffed. Cooperative actions left understaffed are then released,
+    and the assignment is computed again without them, so that their agents fall back on their next proposal.
+    Since at least one action is released per round, it terminates after at most as many rounds as actions.
+
+    Only agents that proposed are known to the solver : callers keeping assignments between solves must release
+    the other performers of a cooperative action joined or left by a solved agent (see @c module::ADL).
+
+    Usage :
+    @code{.cpp}
+    AllocationSolver solver;
+    auto alice = solver.agent(alice_id, 2);         // Qualification of 2
+    auto carry = solver.action(carry_id, 2, 1);     // Arity of 2, requires a qualification of 1
+    solver.propose(alice, carry, 0.8f);
+    // ...
+    solver.solve();
+    if(solver.assignment(alice) == carry) { ... }
+    solver.clear();                                 // Keep the buffers for the next tick.
+    @endcode
+    */
+    class AllocationSolver
+    {
+        struct Proposal
+        {
+            std::uint32_t   agent;
+            std::uint32_t   action;
+            float           score;
+        };
+
+    public:
+        static constexpr std::uint32_t npos = std::numeric_limits<std::uint32_t>::max();
+
+        /**
+        @brief Index of the agent with the given @c id, added with @c qualification if unknown.
+        */
+        std::uint32_t agent(std::uint64_t id, int qualification = 0)
+        {
+            auto [it, inserted] = _agent_index.try_emplace(id, static_cast<std::uint32_t>(_agent_ids.size()));
+            if (inserted)
+            {
+                _agent_ids.push_back(id);
+                _qualification.push_back(qualification);
+            }
+            return it->second;
+        }
+
+        /**
+        @brief Index of the action with the given @c id, added with @c arity and @c required qualification if unknown.
+        */
+        std::uint32_t action(std::uint64_t id, int arity = 1, int required = 0)
+        {
+            auto [it, inserted] = _action_index.try_emplace(id, static_cast<std::uint32_t>(_action_ids.size()));
+            if (inserted)
+            {
+                _action_ids.push_back(id);
+                _arity.push_back(arity);
+                _required.push_back(required);
+            }
+            return it->second;
+        }
+
+        /**
+        @brief Propose to assign @c agent to @c action. Proposals of unqualified agents are ignored.
+        */
+        void propose(std::uint32_t agent, std::uint32_t action, float score = 1.f)
+        {
+            if (_qualification[agent] >= _required[action])
+                _proposals.push_back({ agent, action, score });
+        }
+
+        /**
+        @brief Compute the assignment of all agents.
+        */
+        void solve()
+        {
+            // Ties are broken by insertion order, so that results do not depend on the sort implementation.
+            std::stable_sort(_proposals.begin(), _proposals.end(),
+                [](const Proposal& a, const Proposal& b) { return a.score > b.score; });
+
+            _released.assign(_action_ids.size(), 0);
+            for (;;)
+            {
+                _assignment.assign(_agent_ids.size(), npos);
+                _staffing.assign(_action_ids.size(), 0);
+                for (const auto& proposal : _proposals)
+                {
+                    if (_released[proposal.action] || _assignment[proposal.agent] != npos)
+                        continue;
+                    if (is_cooperative(proposal.action) && _staffing[proposal.action] >= _arity[proposal.action])
+                        continue;
+                    _assignment[proposal.agent] = proposal.action;
+                    _staffing[proposal.action]++;
+                }
+
+                bool released = false;
+                for (size_t a = 0; a < _action_ids.size(); a++)
+                {
+                    if (is_cooperative(a) && _staffing[a] > 0 && _staffing[a] < _arity[a])
+                    {
+                        _released[a] = 1;
+                        released = true;
+                    }
+                }
+                if (!released)
+                    break;
+            }
+        }
+
+        /**
+        @brief Clear agents, actions and proposals, keeping allocated memory.
+        */
+        void clear()
+        {
+            _agent_ids.clear();
+            _qualification.clear();
+            _agent_index.clear();
+            _action_ids.clear();
+            _arity.clear();
+            _required.clear();
+            _action_index.clear();
+            _proposals.clear();
+        }
+
+        inline size_t agents() const { return _agent_ids.size(); }
+        inline size_t actions() const { return _action_ids.size(); }
+        inline size_t proposals() const { return _proposals.size(); }
+        inline std::uint64_t agent_id(size_t agent) const { return _agent_ids[agent]; }
+
+        /**
+        @brief Returns @c true if the agent with the given @c id made a proposal since the last @c clear().
+        */
+        inline bool contains(std::uint64_t id) const { return _agent_index.contains(id); }
+        inline std::uint64_t action_id(size_t action) const { return _action_ids[action]; }
+
+        /**
+        @brief Action assigned to @c agent by the last call to @c solve(), @c npos if none.
+        */
+        inline std::uint32_t assignment(size_t agent) const { return _assignment[agent]; }
+
+        /**
+        @brief Number of agents assigned to @c action by the last call to @c solve().
+        */
+        inline int staffing(size_t action) const { return _staffing[action]; }
+
+    private:
+        inline bool is_cooperative(size_t action) const { return _arity[action] > 1; }
+
+    private:
+        std::vector<std::uint64_t>  _agent_ids {};
+        std::vector<int>            _qualification {};
+        std::unordered_map<std::uint64_t, std::uint32_t> _agent_index {};
+
+        std::vector<std::uint64_t>  _action_ids {};
+        std::vector<int>            _arity {};
+        std::vector<int>            _required {};
+        std::unordered_map<std::uint64_t, std::uint32_t> _action_index {};
+
+        std::vector<Proposal>       _proposals {};
+
+        std::vector<std::uint32_t>  _assignment {};
+        std::vector<int>            _staffing {};
+        std::vector<std::uint8_t>   _released {};
+    };
+}
@@ -0,0 +1,326 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+#include <dynamo/utils/bitset.hpp>
+
+namespace dynamo
+{
+    enum class LogicalConstructor : int
+    {
+        AND = 0,
+        OR,
+        Undefined
+    };
+
+    /**
+    @brief convert a logical constructor to a human-readable string
+    */
+    inline const char* to_string(LogicalConstructor val)
+    {
+        switch (val)
+        {
+			case LogicalConstructor::AND:   return "AND";
+			case LogicalConstructor::OR:    return "OR";
+			default: return "Undefined";
+        }
+    }
+
+    enum class TemporalConstructor : int
+    {
+        SEQ = 0,
+        SEQ_ORD,
+        IND,
+        Undefined
+    };
+
+    /**
+    @brief convert a temporal constructor to a human-readable string
+    */
+    inline const char* to_string(TemporalConstructor val)
+    {
+        switch (val)
+        {
+			case TemporalConstructor::IND:      return "IND";
+			case TemporalConstructor::SEQ:      return "SEQ";
+			case TemporalConstructor::SEQ_ORD:  return "SEQ-ORD";
+			default: return "Undefined";
+        }
+    }
+
+    /**
+    @brief Per-agent progress in a @c TaskTree, indexed by node. Only leaves are meaningful.
+    */
+    struct TaskTreeState
+    {
+        /**
+        @brief Leaves that are done.
+        */
+        DynamicBitset done {};
+
+        /**
+        @brief Leaves that are started (in progress if not done).
+        */
+        DynamicBitset started {};
+    };
+
+    /**
+    @brief Result of a @c TaskTree evaluation, kept between evaluations for incremental updates.
+    */
+    struct TaskTreeEvaluation
+    {
+        std::vector<std::uint8_t>   done {};
+        std::vector<std::uint8_t>   active {};
+        std::vector<std::uint8_t>   enabled {};
+
+        /**
+        @brief Leaves that can be executed now.
+        */
+        DynamicBitset               eligible {};
+    };
+
+    /**
+    @class TaskTree
+
+    @brief An activity tree flattened in pre-order into contiguous arrays.
+
+    The subtree of node @c i spans indices <tt>[i, end(i))</tt>, its first child is <tt>i + 1</tt> and the
+    sibling following a child @c c is <tt>end(c)</tt>. Evaluation is therefore a backward pass (children
+    before parents) to compute which nodes are done, and a forward pass to propagate which nodes are enabled.
+
+    Semantics :
+    - an @c AND node is done when all of its children are, an @c OR node when one of them is ;
+    - @c IND enables all unfinished children, @c SEQ_ORD only the first unfinished one in order,
+    @c SEQ all unfinished children until one is started, then only this one ;
+    - a leaf is eligible when enabled, not done and its preconditions hold.
+    */
+    class TaskTree
+    {
+    public:
+        static constexpr std::uint32_t npos = std::numeric_limits<std::uint32_t>::max();
+
+        /**
+        @brief Open a node under the last opened node. Children must be added before calling @c close(...).
+        @param id Identifier of the node (e.g an entity id).
+        @param preconditions For leaves, whether their preconditions hold.
+        */
+        std::uint32_t open(std::uint64_t id, LogicalConstructor logical = LogicalConstructor::AND,
+            TemporalConstructor temporal = TemporalConstructor::IND, bool preconditions = true)
+        {
+            const auto index = static_cast<std::uint32_t>(_ids.size());
+            _ids.push_back(id);
+            _logical.push_back(logical);
+            _temporal.push_back(temporal);
+            _parent.push_back(_stack.empty() ? npos : _stack.back());
+            _end.push_back(npos);
+            _preconditions.resize(index + 1);
+            _preconditions.set(index, preconditions);
+            _index.emplace(id, index);
+            _stack.push_back(index);
+            return index;
+        }
+
+        /**
+        @brief Close the last opened node.
+        */
+        void close()
+        {
+            _end[_stack.back()] = static_cast<std::uint32_t>(_ids.size());
+            _stack.pop_back();
+        }
+
+        inline size_t size() const { return _ids.size(); }
+        inline bool is_leaf(size_t i) const { return _end[i] == i + 1; }
+        inline std::uint32_t parent(size_t i) const { return _parent[i]; }
+        inline std::uint32_t end(size_t i) const { return _end[i]; }
+        inline std::uint64_t id(size_t i) const { return _ids[i]; }
+        inline LogicalConstructor logical(size_t i) const { return _logical[i]; }
+        inline TemporalConstructor temporal(size_t i) const { return _temporal[i]; }
+
+        /**
+        @brief Index of the node with the given @c id, @c npos if none.
+        */
+        std::uint32_t find(std::uint64_t id) const
+        {
+            auto it = _index.find(id);
+            return it == _index.end() ? npos : it->second;
+        }
+
+        /**
+        @brief Returns a state sized for this tree, with nothing done.
+        */
+        TaskTreeState make_state() const
+        {
+            return { DynamicBitset(size()), DynamicBitset(size()) };
+        }
+
+        /**
+        @brief Returns @c state, built for @c other, translated to the nodes of this tree : progress on nodes
+        that are still in this tree is kept, by id.
+        */
+        TaskTreeState remap(const TaskTreeState& state, const TaskTree& other) const
+        {
+            auto result = make_state();
+            auto translate = [this, &other](const DynamicBitset& from, DynamicBitset& to)
+            {
+                from.for_each([this, &other, &to](size_t i)
+                    {
+                        if (const auto index = find(other.id(i)); index != npos)
+                            to.set(index);
+                    });
+            };
+            translate(state.done, result.done);
+            translate(state.started, result.started);
+            return result;
+        }
+
+        /**
+        @brief Fully evaluate @c state into @c out.
+        */
+        void evaluate(const TaskTreeState& state, TaskTreeEvaluation& out) const
+        {
+            const TaskTreeState* states[] = { &state };
+            TaskTreeEvaluation* outs[] = { &out };
+            evaluate(states, outs);
+        }
+
+        /**
+        @brief Fully evaluate many agents' states in one pass over the tree arrays : each node is visited once,
+        for all agents, instead of once per agent. @c out must be as long as @c states.
+        */
+        void evaluate(std::span<const TaskTreeState* const> states, std::span<TaskTreeEvaluation* const> out) const
+        {
+            const size_t n = size();
+            for (auto evaluation : out)
+            {
+                evaluation->done.assign(n, 0);
+                evaluation->active.assign(n, 0);
+                evaluation->enabled.assign(n, 0);
+                evaluation->eligible.resize(n);
+                evaluation->eligible.reset_all();
+            }
+            if (n == 0)
+                return;
+
+            for (size_t i = n; i-- > 0;)
+            {
+                for (size_t a = 0; a < states.size(); a++)
+                    compute_status(*states[a], *out[a], i);
+            }
+            for (auto evaluation : out)
+                evaluation->enabled[0] = !evaluation->done[0];
+            for (size_t i = 0; i < n; i++)
+            {
+                for (auto evaluation : out)
+                    enable_node(*evaluation, i);
+            }
+        }
+
+        /**
+        @brief Update @c out after the state of leaf @c node changed. Only its ancestors are re-computed,
+        up to the first one whose status is unchanged, and only the subtree of this ancestor is re-enabled.
+        @c out must come from a previous evaluation of the same tree.
+        */
+        void update(const TaskTreeState& state, TaskTreeEvaluation& out, size_t node) const
+        {
+            // The first ancestor whose status did not change keeps its enabled flag, only its subtree needs updating.
+            size_t from = 0;
+            for (size_t i = node; i != npos; i = _parent[i])
+            {
+                const auto done = out.done[i];
+                const auto active = out.active[i];
+                compute_status(state, out, i);
+                if (i != node && done == out.done[i] && active == out.active[i])
+                {
+                    from = i;
+                    break;
+                }
+            }
+
+            if (from == 0)
+                out.enabled[0] = !out.done[0];
+            for (size_t i = from; i < _end[from]; i++)
+            {
+                if (i != from)
+                    out.enabled[i] = 0;
+                out.eligible.reset(i);
+            }
+            enable_subtree(out, from);
+        }
+
+    private:
+        void compute_status(const TaskTreeState& state, TaskTreeEvaluation& out, size_t i) const
+        {
+            if (is_leaf(i))
+            {
+                out.done[i] = state.done.test(i);
+                out.active[i] = state.started.test(i) && !out.done[i];
+                return;
+            }
+
+            const bool is_and = _logical[i] != LogicalConstructor::OR;
+            bool done = is_and;
+            bool active = false;
+            for (size_t c = i + 1; c < _end[i]; c = _end[c])
+            {
+                done = is_and ? (done && out.done[c]) : (done || out.done[c]);
+                active = active || out.active[c];
+            }
+            out.done[i] = done;
+            out.active[i] = active && !done;
+        }
+
+        void enable_subtree(TaskTreeEvaluation& out, size_t root) const
+        {
+            for (size_t i = root; i < _end[root]; i++)
+                enable_node(out, i);
+        }
+
+        /**
+        @brief Mark node @c i as eligible if it is an enabled leaf, or enable its children. Its parent must be processed first.
+        */
+        void enable_node(TaskTreeEvaluation& out, size_t i) const
+        {
+            if (!out.enabled[i] || out.done[i])
+                return;
+
+            if (is_leaf(i))
+            {
+                if (_preconditions.test(i))
+                    out.eligible.set(i);
+                return;
+            }
+
+            std::uint32_t only = npos;
+            if (_temporal[i] == TemporalConstructor::SEQ_ORD)
+            {
+                for (size_t c = i + 1; c < _end[i] && only == npos; c = _end[c])
+                    if (!out.done[c])
+                        only = static_cast<std::uint32_t>(c);
+            }
+            else if (_temporal[i] == TemporalConstructor::SEQ)
+            {
+                for (size_t c = i + 1; c < _end[i] && only == npos; c = _end[c])
+                    if (out.active[c])
+                        only = static_cast<std::uint32_t>(c);
+            }
+
+            for (size_t c = i + 1; c < _end[i]; c = _end[c])
+                out.enabled[c] = !out.done[c] && (only == npos || only == c);
+        }
+
+    private:
+        std::vector<std::uint64_t>          _ids {};
+        std::vector<LogicalConstructor>     _logical {};
+        std::vector<TemporalConstructor>    _temporal {};
+        std::vector<std::uint32_t>          _parent {};
+        std::vector<std::uint32_t>          _end {};
+        DynamicBitset                       _preconditions {};
+        std::unordered_map<std::uint64_t, std::uint32_t> _index {};
+        std::vector<std::uint32_t>          _stack {};
+    };
+}
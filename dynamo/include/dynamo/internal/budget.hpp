@@ -0,0 +1,78 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+
+/**
+@file dynamo/internal/budget.hpp
+@brief Cancellation of anytime processes once the reasoning budget of a tick is spent.
+*/
+namespace dynamo
+{
+    /**
+    @class CancellationToken
+
+    @brief Flag shared between the simulation, which sets it when the reasoning budget is spent, and processes reading it.
+    A default-constructed token is never cancelled.
+    */
+    class CancellationToken
+    {
+    public:
+        CancellationToken() = default;
+
+        /**
+        @brief Returns a token that can be cancelled.
+        */
+        static CancellationToken create()
+        {
+            CancellationToken token{};
+            token.flag = std::make_shared<std::atomic<bool>>(false);
+            return token;
+        }
+
+        inline bool cancelled() const { return flag && flag->load(std::memory_order_acquire); }
+
+        inline void cancel() { if (flag) flag->store(true, std::memory_order_release); }
+
+        inline void reset() { if (flag) flag->store(false, std::memory_order_release); }
+
+    private:
+        std::shared_ptr<std::atomic<bool>> flag {};
+    };
+
+    /**
+    @brief Singleton holding the token cancelled by @c Simulation when the reasoning budget of a tick is spent,
+    see @c Simulation::reasoning_budget(...).
+    */
+    struct ReasoningBudget
+    {
+        CancellationToken token { CancellationToken::create() };
+    };
+
+    namespace detail {
+        /**
+        @brief Token of the anytime process computed by this thread, if any.
+        */
+        inline thread_local const CancellationToken* current_token = nullptr;
+
+        struct TokenScope
+        {
+            explicit TokenScope(const CancellationToken* token) : previous{ current_token } { current_token = token; }
+            ~TokenScope() { current_token = previous; }
+
+            TokenScope(const TokenScope&) = delete;
+            TokenScope& operator=(const TokenScope&) = delete;
+
+            const CancellationToken* previous;
+        };
+    }
+
+    /**
+    @brief Returns @c true if the anytime process computed by the calling thread should return its best result so far,
+    see @c Process<T>::anytime(). Always @c false elsewhere.
+    */
+    inline bool cancelled()
+    {
+        return detail::current_token && detail::current_token->cancelled();
+    }
+}
@@ -1,6 +1,9 @@
 #pragma once
 
+#include <chrono>
+#include <memory>
 #include <vector>
+#include <unordered_map>
 
 #include <taskflow/taskflow.hpp>
 
@@ -31,6 +34,14 @@ namespace dynamo
      */
     struct CurrentFrame {};
 
+    /**
+    @brief Singleton holding the simulated time elapsed since the simulation started (in seconds).
+    */
+    struct Clock
+    {
+        float time {0.f};
+    };
+
     /**
     @brief When @c ttl (in seconds) reaches 0, the entity holding this component is destroyed.
     */
@@ -86,6 +97,89 @@ namespace dynamo
         std::vector<flecs::entity_view> entities;
     };
 
+    /**
+    @brief Materialized transitive closure of the @c perceive relation.
+
+    Maps every entity reachable from the holder through @c perceive to the number of percepts
+    leading to it. Membership checks are O(1) and iteration is O(k), instead of walking percept
+    chains at query time. Updated along every chain of percepts when a @c perceive relation is added
+    (see @c Percept::perceived_by) or when a perceived entity expires (see @c module::Core).
+    */
+    struct PerceivedSources
+    {
+        /**
+        @brief Number of live percepts through which an entity is perceived.
+        */
+        std::unordered_map<flecs::entity_t, std::uint32_t> counts {};
+
+        /**
+        @brief Returns @c true if @c target is reachable through @c perceive.
+        */
+        inline bool contains(flecs::entity_t target) const { return counts.contains(target); }
+
+        /**
+        @brief Number of distinct entities perceived.
+        */
+        inline size_t size() const { return counts.size(); }
+
+        /**
+        @brief Add @c n paths to @c target.
+        */
+        inline void add(flecs::entity_t target, std::uint32_t n = 1) { counts[target] += n; }
+
+        /**
+        @brief Add every entity perceived by @c other.
+        */
+        inline void add(const PerceivedSources& other)
+        {
+            for (const auto& [target, n] : other.counts)
+                counts[target] += n;
+        }
+
+        /**
+        @brief Remove @c n paths to @c target. Entry is erased when no path is left.
+        */
+        inline void remove(flecs::entity_t target, std::uint32_t n = 1)
+        {
+            auto it = counts.find(target);
+            if (it == counts.end())
+                return;
+            if (it->second <= n)
+                counts.erase(it);
+            else
+                it->second -= n;
+        }
+
+        /**
+        @brief Remove every entity perceived by @c other.
+        */
+        inline void remove(const PerceivedSources& other)
+        {
+            for (const auto& [target, n] : other.counts)
+                remove(target, n);
+        }
+
+        /**
+        @brief Iterate over perceived entities.
+        @tparam T Accept function with following signature : @c std::function<void(flecs::entity_t)>
+        */
+        template<typename T>
+        void each(T&& func) const
+        {
+            for (const auto& [target, _] : counts)
+                func(target);
+        }
+    };
+
+    /**
+    @brief Entities directly perceiving the holder. Used to propagate changes of its @c PerceivedSources to them,
+    and to update theirs when it expires. May hold dead entities.
+    */
+    struct Perceivers
+    {
+        std::vector<flecs::entity_t> entities {};
+    };
+
     /**
     @brief Little hack to delay the creation of @c Flow as it isn't copyable.
     */
@@ -94,6 +188,40 @@ namespace dynamo
     {
         bool    is_cyclic   { true };
         float   period      { 1.0f };
+
+        /**
+        @brief Wall-clock time (in milliseconds) a run may take before being cancelled. If 0, the deadline of the flow type
+        is used, if any (see @c Simulation::FlowTriggers<T>::deadline(...)).
+        */
+        float   deadline    { 0.f };
+    };
+
+    /**
+    @brief Priority of the flows of an agent (set on the agent) or of one flow (set on the flow entity), summed up.
+    Due flows with a higher priority are launched first, see @c Simulation::priority_aging(...).
+    */
+    struct Priority
+    {
+        int value {0};
+    };
+
+    /**
+    @brief Set on flow entities : a run of the flow is cancelled by the simulation if it takes longer than @c value.
+    */
+    struct Deadline
+    {
+        std::chrono::duration<double, std::milli> value {0};
+
+        /**
+        @brief Factor applied to the period of a cyclic flow each time it overruns (1 : no back off).
+        The flow is then paused for its new period.
+        */
+        float back_off {1.f};
+
+        /**
+        @brief Upper bound of the backed off period, in seconds.
+        */
+        float max_period {60.f};
     };
 
     /**
@@ -102,9 +230,10 @@ namespace dynamo
     struct Flow 
     {
         /**
-        @brief Taskflow.
+        @brief Taskflow. Held by pointer, so that it stays in place while running, even when the flow entity
+        moves to another table (e.g when @c Status or @c Cooldown are added or removed).
         */
-        tf::Taskflow taskflow;
+        std::unique_ptr<tf::Taskflow> taskflow;
     };
 
     /**
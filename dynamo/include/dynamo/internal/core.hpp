@@ -4,6 +4,10 @@
 
 #include <effolkronium/random.hpp>
 
+#include <dynamo/internal/jobs.hpp>
+#include <dynamo/internal/budget.hpp>
+#include <dynamo/internal/memo.hpp>
+#include <dynamo/internal/routine.hpp>
 #include <dynamo/internal/types.hpp>
 
 /**
@@ -1,14 +1,24 @@
 #pragma once
 
+#include <algorithm>
 #include <assert.h>
 #include <chrono>
+#include <concepts>
+#include <cstdint>
 #include <thread>
 #include <functional>
+#include <string>
+#include <tuple>
 #include <typeinfo>
+#include <unordered_map>
 
 #include <taskflow/taskflow.hpp>
 
+#include <dynamo/internal/budget.hpp>
+#include <dynamo/internal/memo.hpp>
+#include <dynamo/internal/routine.hpp>
 #include <dynamo/internal/types.hpp>
+#include <dynamo/utils/hash.hpp>
 #include <dynamo/utils/containers.hpp>
 
 /**
@@ -75,6 +85,7 @@ namespace dynamo {
 
     //Forward Declaration
     class AgentHandle;
+    class FlowBuilder;
 
     template<typename T>
     using TaskMap = std::unordered_map<size_t, T>;
@@ -85,6 +96,7 @@ namespace dynamo {
         Composed,
         Conditional,
         Static,
+        Routine,
         Not_a_process,
         Undefined
     };
@@ -98,11 +110,81 @@ namespace dynamo {
         case ProcessType::Composed:         return "Composed";
         case ProcessType::Conditional:      return "Conditional";
         case ProcessType::Static:           return "Static";
+        case ProcessType::Routine:          return "Routine";
         case ProcessType::Not_a_process:    return "Not_a_process";
         default:                            return "Undefined";
         }
     }
     
+    /**
+    @brief Passed first to @c FlowBuilder::process<...>(...) to share the results of the process between agents.
+
+    Results are looked up in the @c MemoCache of the world before being computed, keyed on the strategy, the inputs,
+    the versions of the components the process reads (see @c Process<T>::reads()) and the value returned by @c key (if any).
+    Versions only tell when a component changed, not its value : agents with different values are told apart by @c key.
+    Behaviours must only depend on these (e.g on the archetype, or on the actions available in the world).
+    Inputs must be @c Hashable and comparable with @c operator==, which is checked at compile time.
+    */
+    struct Memoized
+    {
+        std::function<size_t(const AgentHandle&)> key {};
+
+        /**
+        @brief If @c true, results are only shared during a tick. Otherwise, @c key and read components should
+        change whenever the result may change.
+        */
+        bool per_tick {true};
+    };
+
+    /**
+    @brief Shared between a process and its task, to skip the computation when its inputs did not change.
+    */
+    struct ProcessState
+    {
+        /**
+        @brief Incremented each time the output changes. Outputs comparable with @c operator== only change
+        when a different value is computed. Only incremental downstream processes check it to be skipped.
+        */
+        std::uint64_t version {0};
+
+        /**
+        @brief If @c true, the process is skipped when the versions of its inputs are the same as last run.
+        */
+        bool incremental {false};
+
+        bool computed {false};
+
+        /**
+        @brief Versions of the components read by the process, see @c Process<T>::reads().
+        */
+        std::vector<std::function<std::uint64_t(const AgentHandle&)>> reads {};
+
+        /**
+        @brief Versions of upstream outputs and read components at the last computation.
+        */
+        std::vector<std::uint64_t> inputs {};
+
+        /**
+        @brief Cache shared by all agents, looked up before computing if @c memoized is @c true, see @c Memoized.
+        */
+        std::shared_ptr<MemoCache> cache {};
+        bool memoized {false};
+        bool memo_per_tick {true};
+        std::function<size_t(const AgentHandle&)> memo_key {};
+
+        /**
+        @brief If @c true, the process is not computed once @c token is cancelled, see @c Process<T>::anytime().
+        */
+        bool anytime {false};
+        CancellationToken token {};
+
+        size_t computations {0};
+        size_t skipped {0};
+        size_t hits {0};
+        size_t misses {0};
+        size_t interrupted {0};
+    };
+
     /**
     @class Operation 
 
@@ -111,6 +193,7 @@ namespace dynamo {
     class ProcessBase
     {
         friend class FlowBuilder;
+        friend class Conditional;
 
         template <typename U>
         friend class Process;
@@ -187,6 +270,21 @@ namespace dynamo {
         
         std::type_index strategy_index() { return _strategy_index; }
 
+        /**
+        @brief Returns the state shared with the task, @c nullptr if it is not a process.
+        */
+        inline const ProcessState* state() const { return _state.get(); }
+
+        /**
+        @brief For a conditional process, hashes of the entry task of each branch, by index.
+        */
+        inline const std::vector<size_t>& branches() const { return _branches; }
+
+        /**
+        @brief For a composed process, the flow used as a module, @c nullptr otherwise.
+        */
+        inline const FlowBuilder* module() const { return _module.get(); }
+
     protected:
 
         template <typename U>
@@ -201,6 +299,9 @@ namespace dynamo {
         tf::Task                _task;
         std::type_index         _strategy_index;
         TaskMap<const char *>   _input_names {};
+        std::shared_ptr<ProcessState> _state {};
+        std::vector<size_t>     _branches {};
+        std::shared_ptr<const FlowBuilder> _module {};
     };
 
     /**
@@ -211,9 +312,20 @@ namespace dynamo {
     class Process
     {
         friend class FlowBuilder;
+
+        template <typename U>
+        friend class Module;
     public:
         Process(ProcessBase& process, std::shared_ptr<T> result) :
-            process{ process }, result {result}
+            process{ process }, result{ result }, state{ process._state }
+        {}
+
+        /**
+        @brief Construct a process whose task is @c process, but whose result and state come from another one
+        (e.g a process of a composed module).
+        */
+        Process(ProcessBase& process, std::shared_ptr<T> result, std::shared_ptr<ProcessState> state) :
+            process{ process }, result{ result }, state{ state }
         {}
 
         /**
@@ -258,6 +370,40 @@ namespace dynamo {
             return result;
         }
 
+        /**
+        @brief Declare the components read by this process and make it incremental : it is skipped, keeping its
+        previous output, as long as its upstream outputs and these components did not change.
+        Components should be flow-readable (see @c dynamo::snapshot<T>(...)), otherwise they are considered changed at every step.
+        */
+        template<typename ... Ts>
+        Process<T>& reads()
+        {
+            (state->reads.emplace_back([](const AgentHandle& agent) { return agent.template version<Ts>(); }), ...);
+            state->incremental = true;
+            return *this;
+        }
+
+        /**
+        @brief Make this process incremental without reading any component : it is only computed again when its upstream outputs change.
+        Behaviours must not depend on anything else.
+        */
+        inline Process<T>& incremental()
+        {
+            state->incremental = true;
+            return *this;
+        }
+
+        /**
+        @brief Make this process anytime : once the reasoning budget of the tick is spent (see @c Simulation::reasoning_budget(...)),
+        it keeps its previous output instead of being computed, and its behaviours can check @c dynamo::cancelled()
+        to return their best result so far.
+        */
+        inline Process<T>& anytime()
+        {
+            state->anytime = true;
+            return *this;
+        }
+
     protected:
 
         template <typename U>
@@ -269,6 +415,112 @@ namespace dynamo {
     private:
         ProcessBase&        process;
         std::shared_ptr<T>  result;
+        std::shared_ptr<ProcessState> state;
+    };
+
+    /**
+    @class Conditional
+    @brief A process choosing which of its branches runs next, from the index returned by its strategy.
+
+    Tasks and processes of a branch must succeed its entry task, see @c branch(...). They only run if
+    this branch is chosen, so whole sub-graphs are skipped. A task depending on several branches never
+    runs, as only one of them is taken.
+    */
+    class Conditional
+    {
+        friend class FlowBuilder;
+    public:
+        Conditional(ProcessBase& process, FlowBuilder& flow) :
+            process{ process }, flow{ flow }
+        {}
+
+        /**
+        @brief Returns underlying task.
+        */
+        inline tf::Task task() { return process.task(); }
+
+        /**
+        @brief Returns underlying task hash value.
+        */
+        inline size_t hash_value() { return process.hash_value(); }
+
+        /**
+        @brief Set process' name (Use for debugging/visualization).
+        */
+        inline void name(const char* name) { process.name(name); }
+
+        /**
+        @brief Add a dependency with no inputs.
+        */
+        inline void succeed(tf::Task& t) { process.succeed(t); }
+
+        /**
+        @brief Add the next branch, chosen when the strategy returns its index (the number of branches added before it).
+        Returns its entry task.
+        */
+        tf::Task branch(const char* name);
+
+        /**
+        @brief Number of branches added so far.
+        */
+        inline size_t number_of_branches() const { return process._branches.size(); }
+
+    private:
+        ProcessBase&            process;
+        FlowBuilder&            flow;
+    };
+
+    /**
+    @class Module
+    @brief A process running another flow, @c TFlow, built for the same agent.
+    */
+    template<typename TFlow>
+    class Module
+    {
+        friend class FlowBuilder;
+    public:
+        Module(ProcessBase& process, std::shared_ptr<TFlow> flow) :
+            process{ process }, flow{ flow }
+        {}
+
+        /**
+        @brief Returns underlying task.
+        */
+        inline tf::Task task() { return process.task(); }
+
+        /**
+        @brief Returns underlying task hash value.
+        */
+        inline size_t hash_value() { return process.hash_value(); }
+
+        /**
+        @brief Set process' name (Use for debugging/visualization).
+        */
+        inline void name(const char* name) { process.name(name); }
+
+        /**
+        @brief Add a dependency with no inputs.
+        */
+        inline void succeed(tf::Task& t) { process.succeed(t); }
+
+        /**
+        @brief Access the module, e.g to retrieve its processes.
+        */
+        inline TFlow* operator->() { return flow.get(); }
+
+        /**
+        @brief Returns @c output, a process of the module, as a process of this flow : processes taking it as input
+        run once the whole module is done.
+        */
+        template<typename U>
+        Process<U> output(Process<U>& output)
+        {
+            return Process<U>(process, output.result, output.state);
+        }
+
+    private:
+        ProcessBase&            process;
+        std::shared_ptr<TFlow>  flow;
     };
 
     /**
@@ -431,6 +683,44 @@ namespace dynamo {
     };
 
     using Strategies = TypeMap;
+
+    namespace type
+    {
+        /**
+        @brief Component with a map to retrieve the process corresponding to a task.
+        */
+        struct ProcessDetails
+        {
+            /**
+            @brief Map of task's hash to a process (encapsulated in an any, as there multiple type of processes).
+            */
+            TaskMap<ProcessBase> container;
+
+            /**
+            @brief Logical graph of the flow, the one processes' tasks belong to. It is never run.
+            */
+            std::shared_ptr<tf::Taskflow> graph {};
+
+            /**
+            @brief Map of a logical task's hash to the hash of the task running it, see @c FlowBuilder::fuse().
+            */
+            TaskMap<size_t> execution {};
+
+            ProcessBase find(size_t hash) const
+            {
+                return container.at(hash);
+            }
+
+            /**
+            @brief Returns the hash of the task running the logical task @c hash, @c hash itself if unknown.
+            */
+            size_t executed_task(size_t hash) const
+            {
+                auto it = execution.find(hash);
+                return it == execution.end() ? hash : it->second;
+            }
+        };
+    }
     /**
     @class FlowBuilder
 
@@ -474,12 +764,12 @@ namespace dynamo {
         virtual void build() = 0;
 
         /**
-        @brief Implicit conversion operator to convert it into taskflow.
+        @brief Implicit conversion operator to convert it into taskflow : the executed graph, see @c fuse().
         */
         inline operator tf::Taskflow && ()
         {
-            taskflow.name(name());
-            return std::move(taskflow);
+            fuse();
+            return std::move(executed);
         }
 
         /**
@@ -487,9 +777,158 @@ namespace dynamo {
         */
         virtual constexpr const char* name() const = 0;
 
-        TaskMap<ProcessBase> process_details() const
+        /**
+        @brief Returns processes, the logical graph and where its tasks are run. Call it before the conversion
+        to a taskflow.
+        */
+        type::ProcessDetails process_details()
         {
-            return task_to_process;
+            fuse();
+            return { task_to_process, graph, execution };
+        }
+
+        /**
+        @brief Build the executed graph from the logical one, once the flow is built : tasks with no work (e.g static values)
+        are removed, and linear chains of tasks are fused into single tasks, saving a scheduling round trip per task.
+        Conditional and composed processes are kept as they are. Does nothing if already called.
+
+        The logical graph is kept for visualization, see @c process_details().
+        */
+        void fuse()
+        {
+            if (fused)
+                return;
+            fused = true;
+            graph->name(name());
+            executed.name(name());
+
+            struct Node
+            {
+                tf::Task            task;
+                Work*               work;
+                std::vector<size_t> successors {};
+                std::vector<size_t> dependents {};
+                bool                removed {false};
+            };
+            auto link = [](std::vector<size_t>& container, size_t hash)
+            {
+                if (std::find(container.begin(), container.end(), hash) == container.end())
+                    container.push_back(hash);
+            };
+
+            // Duplicated edges (e.g a process taking twice the same input) are merged.
+            std::vector<size_t> order {};
+            std::unordered_map<size_t, Node> nodes {};
+            graph->for_each_task([this, &order, &nodes, &link](tf::Task task)
+                {
+                    auto& node = nodes.emplace(task.hash_value(), Node{ task, &works.at(task.hash_value()) }).first->second;
+                    task.for_each_successor([&node, &link](tf::Task successor) { link(node.successors, successor.hash_value()); });
+                    order.push_back(task.hash_value());
+                });
+            for (auto hash : order)
+                for (auto successor : nodes.at(hash).successors)
+                    nodes.at(successor).dependents.push_back(hash);
+
+            auto kind = [&nodes](size_t hash) { return nodes.at(hash).work->kind; };
+            auto unlink = [](std::vector<size_t>& container, size_t hash)
+            {
+                container.erase(std::remove(container.begin(), container.end(), hash), container.end());
+            };
+
+            // Remove tasks with no work, linking their dependents to their successors. Successors of a condition task are kept, as their index matters.
+            for (auto hash : order)
+            {
+                auto& node = nodes.at(hash);
+                if (node.work->kind != Work::Kind::Noop
+                    || std::any_of(node.dependents.begin(), node.dependents.end(), [&kind](size_t d) { return kind(d) == Work::Kind::Condition; }))
+                    continue;
+                for (auto dependent : node.dependents)
+                {
+                    unlink(nodes.at(dependent).successors, hash);
+                    for (auto successor : node.successors)
+                        link(nodes.at(dependent).successors, successor);
+                }
+                for (auto successor : node.successors)
+                {
+                    unlink(nodes.at(successor).dependents, hash);
+                    for (auto dependent : node.dependents)
+                        link(nodes.at(successor).dependents, dependent);
+                }
+                node.removed = true;
+            }
+
+            // A plain task is fused into its only dependent, if it is its only successor.
+            auto is_fused = [&nodes, &kind](size_t hash)
+            {
+                const auto& node = nodes.at(hash);
+                if (node.work->kind != Work::Kind::Plain || node.dependents.size() != 1)
+                    return false;
+                const auto dependent = node.dependents.front();
+                return (kind(dependent) == Work::Kind::Plain || kind(dependent) == Work::Kind::Branch)
+                    && nodes.at(dependent).successors.size() == 1;
+            };
+
+            std::unordered_map<size_t, tf::Task> tasks {};
+            for (auto hash : order)
+            {
+                if (nodes.at(hash).removed || is_fused(hash))
+                    continue;
+
+                auto& head = nodes.at(hash);
+                tf::Task task;
+                if (head.work->kind == Work::Kind::Condition)
+                    task = executed.emplace(std::move(head.work->condition));
+                else if (head.work->kind == Work::Kind::Module)
+                    task = executed.emplace(std::move(head.work->module));
+                else
+                {
+                    std::vector<size_t> chain{ hash };
+                    while (nodes.at(chain.back()).successors.size() == 1 && is_fused(nodes.at(chain.back()).successors.front()))
+                        chain.push_back(nodes.at(chain.back()).successors.front());
+
+                    std::vector<std::function<void()>> works {};
+                    std::string names {};
+                    for (auto h : chain)
+                    {
+                        auto& node = nodes.at(h);
+                        if (node.work->plain)
+                            works.emplace_back(std::move(node.work->plain));
+                        names += (names.empty() ? "" : " + ") + node.task.name();
+                    }
+
+                    if (works.size() == 1)
+                        task = executed.emplace(std::move(works.front()));
+                    else
+                        task = executed.emplace([works = std::move(works)]() mutable {
+                            for (auto& work : works)
+                                work();
+                        });
+                    task.name(names);
+                    for (auto h : chain)
+                    {
+                        execution[h] = task.hash_value();
+                        tasks.emplace(h, task);
+                    }
+                    continue;
+                }
+                task.name(head.task.name());
+                execution[hash] = task.hash_value();
+                tasks.emplace(hash, task);
+            }
+
+            // In order, so that successors of condition tasks keep their index.
+            for (auto hash : order)
+            {
+                if (nodes.at(hash).removed)
+                    continue;
+                for (auto successor : nodes.at(hash).successors)
+                {
+                    auto from = tasks.at(hash);
+                    auto to = tasks.at(successor);
+                    if (from != to)
+                        from.precede(to);
+                }
+            }
         }
 
     protected:
@@ -502,11 +941,31 @@ namespace dynamo {
         template<typename T>
         tf::Task emplace(T&& t)
         {
-            auto task = taskflow.placeholder();
-            task_to_process.emplace(task.hash_value(), ProcessBase{ task, typeid(void), ProcessType::Not_a_process }).first->second;
-            task.work([a = this->agent, &t]() {
-                std::forward<T>(t)(a);
-            });
+            auto task = record({ Work::Kind::Plain, [a = this->agent, t = std::forward<T>(t)]() mutable {
+                t(a);
+            } });
+            task_to_process.emplace(task.hash_value(), ProcessBase{ task, typeid(void), ProcessType::Not_a_process });
+            return task;
+        };
+
+        /**
+        @brief Emplace a coroutine process, i.e a callable matching @c std::function<Routine(AgentHandle)>.
+
+        The routine starts when its task runs and the task completes as soon as it suspends : while waiting,
+        it holds no worker thread and it is resumed by the simulation, see @c dynamo/internal/routine.hpp.
+        As long as it is in flight, it is not started again by the next launches of the flow. An exception ends the routine
+        and is reported to the scheduler, see @c RoutineScheduler::failures().
+        Arguments are copied into the coroutine frame but captures are not : prefer capture-less lambdas.
+        */
+        template<typename F>
+        tf::Task routine(F&& f)
+        {
+            auto slot = std::make_shared<RoutineSlot>();
+            slot->scheduler = detail::scheduler_of(this->agent);
+            auto task = record({ Work::Kind::Plain, [a = this->agent, f = std::forward<F>(f), slot = std::move(slot)]() mutable {
+                RoutineSlot::start(slot, [&f, &a]() { return f(a); });
+            } });
+            task_to_process.emplace(task.hash_value(), ProcessBase{ task, typeid(F), ProcessType::Routine });
             return task;
         };
 
@@ -516,62 +975,249 @@ namespace dynamo {
         template<template<typename, typename ...> typename T, typename TOutput, typename ... TInputs>
         Process<TOutput> process(Process<TInputs>& ... inputs)
         {
-            auto task       = taskflow.placeholder();
+            return make_process<false, T, TOutput, TInputs...>({}, inputs...);
+        };
+
+        /**
+        @brief Emplace a process whose results are shared between agents, see @c Memoized.
+        */
+        template<template<typename, typename ...> typename T, typename TOutput, typename ... TInputs>
+        Process<TOutput> process(Memoized memo, Process<TInputs>& ... inputs)
+        {
+            static_assert(((Hashable<TInputs> && std::equality_comparable<TInputs>) && ...),
+                "Inputs of a memoized process must be Hashable and comparable with operator==.");
+            return make_process<true, T, TOutput, TInputs...>(std::move(memo), inputs...);
+        };
+
+    private:
+        template<bool Memoize, template<typename, typename ...> typename T, typename TOutput, typename ... TInputs>
+        Process<TOutput> make_process(Memoized memo, Process<TInputs>& ... inputs)
+        {
+            auto task       = record({ Work::Kind::Plain });
             ProcessBase& pb = task_to_process.emplace(task.hash_value(), ProcessBase{task, typeid(T<TOutput, TInputs...>), ProcessType::Simple}).first->second;
             (pb.succeed(inputs), ...);
             
             auto output     = std::make_shared<TOutput>();
+            pb._state       = std::make_shared<ProcessState>();
+            if (auto memoization = agent.entity().world().get<Memoization>())
+                pb._state->cache = memoization->cache;
+            pb._state->memoized = Memoize && pb._state->cache;
+            pb._state->memo_key = std::move(memo.key);
+            pb._state->memo_per_tick = memo.per_tick;
+            if (auto budget = agent.entity().world().get<ReasoningBudget>())
+                pb._state->token = budget->token;
             Process<TOutput> p (pb, output);
 
-            task.work(
-                [strat = this->strategies, a = this->agent, ... args = inputs.result, res = std::move(output)]() mutable
+            works.at(task.hash_value()).plain =
+                [strat = this->strategies, a = this->agent, ... args = inputs.result, ... upstream = inputs.state, res = std::move(output), state = pb._state]() mutable
                 {
-                    *res = strat->get<T<TOutput, TInputs...>>()(a, *args ...);
-                }
-            );
+                    if (state->incremental)
+                    {
+                        bool changed = !state->computed;
+                        size_t i = 0;
+                        auto track = [&state, &changed, &i](std::uint64_t version)
+                        {
+                            if (i == state->inputs.size())
+                            {
+                                state->inputs.push_back(version);
+                                changed = true;
+                            }
+                            else if (state->inputs[i] != version)
+                            {
+                                state->inputs[i] = version;
+                                changed = true;
+                            }
+                            i++;
+                        };
+                        (track(upstream->version), ...);
+                        for (const auto& read : state->reads)
+                            track(read(a));
+
+                        if (!changed)
+                        {
+                            state->skipped++;
+                            return;
+                        }
+                    }
+
+                    // Out of time : the previous output is the best this process has.
+                    if (state->anytime && state->computed && state->token.cancelled())
+                    {
+                        state->interrupted++;
+                        return;
+                    }
+
+                    using Strategy_t = T<TOutput, TInputs...>;
+                    std::shared_ptr<const TOutput> cached {};
+                    [[maybe_unused]] size_t key = 0;
+                    // Results are keyed on the inputs, the agent's key and the versions of read components,
+                    // compared on lookup so that colliding hashes are not shared.
+                    using MemoKey_t = std::tuple<TInputs ..., size_t, std::vector<std::uint64_t>>;
+                    [[maybe_unused]] size_t agent_key = 0;
+                    [[maybe_unused]] std::vector<std::uint64_t> read_versions {};
+                    if constexpr (Memoize)
+                    {
+                        if (state->memoized)
+                        {
+                            key = hash_of(*args ...);
+                            if (state->memo_key)
+                            {
+                                agent_key = state->memo_key(a);
+                                hash_combine(key, agent_key);
+                            }
+                            read_versions.reserve(state->reads.size());
+                            for (const auto& read : state->reads)
+                            {
+                                read_versions.push_back(read(a));
+                                hash_combine(key, read_versions.back());
+                            }
+                            cached = state->cache->find<TOutput, MemoKey_t>(typeid(Strategy_t), key, std::tie(*args ..., agent_key, read_versions), state->memo_per_tick);
+                            if (cached)
+                                state->hits++;
+                            else
+                                state->misses++;
+                        }
+                    }
+
+                    detail::TokenScope scope{ state->anytime ? &state->token : nullptr };
+                    TOutput value = cached ? *cached : strat->get<Strategy_t>()(a, *args ...);
+                    if (!cached)
+                    {
+                        state->computations++;
+                        if constexpr (Memoize)
+                        {
+                            if (state->memoized)
+                                state->cache->insert(typeid(Strategy_t), key, MemoKey_t{ *args ..., agent_key, std::move(read_versions) }, value, state->memo_per_tick);
+                        }
+                    }
+                    // Incremental downstream processes are skipped in turn if the output is the same. Others are always computed,
+                    // since they may read anything : a chain is only skipped up to its first non-incremental process.
+                    if constexpr (std::equality_comparable<TOutput>)
+                    {
+                        if (state->computed && value == *res)
+                            return;
+                    }
+                    *res = std::move(value);
+                    state->version++;
+                    state->computed = true;
+                };
 
             return p;
         };
 
+    protected:
         template<typename T, typename ... Args>
         Process<T> static_value(Args&& ... args)
         {
-            auto task       = taskflow.placeholder();
+            // Processes using it hold the value, so it has no work and is removed from the executed graph.
+            auto task       = record({ Work::Kind::Noop });
             ProcessBase& pb = task_to_process.emplace(task.hash_value(), ProcessBase{task, typeid(T), ProcessType::Static}).first->second;
             
             auto output = std::make_shared<T>(T{ std::forward<Args>(args)... });
+            pb._state   = std::make_shared<ProcessState>(ProcessState{ .version = 1, .computed = true });
             Process<T> p (pb, output);
 
-            // Empty task that is just mainting a counter for the shared ptr.
-            task.work([res = std::move(output)]() mutable {});
-
             return p;
         }
 
-    private:
+        /**
+        @brief Emplace a conditional process. Its strategy returns the index of the branch to run, see @c Conditional.
+        */
+        template<template<typename, typename ...> typename T, typename ... TInputs>
+        Conditional conditional(Process<TInputs>& ... inputs)
+        {
+            // Returning an int makes it a condition task : only the successor at this index is run.
+            auto task       = record({ Work::Kind::Condition, {},
+                [strat = this->strategies, a = this->agent, ... args = inputs.result]() mutable -> int
+                {
+                    return strat->get<T<int, TInputs...>>()(a, *args ...);
+                }
+            });
+            ProcessBase& pb = task_to_process.emplace(task.hash_value(), ProcessBase{task, typeid(T<int, TInputs...>), ProcessType::Conditional}).first->second;
+            (pb.succeed(inputs), ...);
 
-        Strategies const * const strategies;
-        AgentHandle     agent;
-        tf::Taskflow    taskflow {};
-        TaskMap<ProcessBase> task_to_process;
-    };
+            return Conditional(pb, *this);
+        }
 
-    namespace type
-    {
         /**
-        @brief Component with a map to retrieve the process corresponding to a task.
+        @brief Emplace a composed process, running the flow @c TFlow built for the same agent. @c args are forwarded
+        to its constructor, after the strategies and the agent.
         */
-        struct ProcessDetails
+        template<typename TFlow, typename ... Args>
+        Module<TFlow> compose(Args&& ... args)
         {
-            /**
-            @brief Map of task's hash to a process (encapsulated in an any, as there multiple type of processes).
-            */
-            TaskMap<ProcessBase> container;
+            auto flow = std::make_shared<TFlow>(strategies, agent, std::forward<Args>(args)...);
+            flow->build();
+            FlowBuilder& module = *flow;
+            module.fuse();
 
-            ProcessBase find(size_t hash) const
+            // The module is owned by the task, so that its taskflow outlives every run.
+            auto task       = record({ Work::Kind::Module, {}, {}, [flow](tf::Subflow& subflow)
+                {
+                    subflow.composed_of(static_cast<FlowBuilder&>(*flow).executed);
+                }
+            });
+            ProcessBase& pb = task_to_process.emplace(task.hash_value(), ProcessBase{task, typeid(TFlow), ProcessType::Composed}).first->second;
+            pb._module      = flow;
+            task.name(module.name());
+
+            return Module<TFlow>(pb, flow);
+        }
+
+    private:
+        friend class Conditional;
+
+        /**
+        @brief What a task of the logical graph runs. Recorded, so that @c fuse() can build the executed graph.
+        */
+        struct Work
+        {
+            enum class Kind
             {
-                return container.at(hash);
-            }
+                Plain,
+                Noop,
+                Branch,
+                Condition,
+                Module
+            };
+
+            Kind                                kind {Kind::Plain};
+            std::function<void()>               plain {};
+            std::function<int()>                condition {};
+            std::function<void(tf::Subflow&)>   module {};
         };
+
+        /**
+        @brief Add a task to the logical graph, running @c work once fused.
+        */
+        tf::Task record(Work work)
+        {
+            auto task = graph->placeholder();
+            works.emplace(task.hash_value(), std::move(work));
+            return task;
+        }
+
+    protected:
+        Strategies const * const strategies;
+        AgentHandle     agent;
+
+    private:
+        std::shared_ptr<tf::Taskflow> graph { std::make_shared<tf::Taskflow>() };
+        tf::Taskflow    executed {};
+        std::unordered_map<size_t, Work> works {};
+        TaskMap<size_t> execution {};
+        bool            fused {false};
+        TaskMap<ProcessBase> task_to_process;
+    };
+
+    inline tf::Task Conditional::branch(const char* name)
+    {
+        auto entry = flow.record({ FlowBuilder::Work::Kind::Branch });
+        entry.name(name);
+        flow.task_to_process.emplace(entry.hash_value(), ProcessBase{ entry, typeid(void), ProcessType::Not_a_process });
+        process.task().precede(entry);
+        process._branches.push_back(entry.hash_value());
+        return entry;
     }
+
 }
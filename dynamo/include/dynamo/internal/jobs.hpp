@@ -0,0 +1,133 @@
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <flecs.h>
+
+/**
+@file dynamo/internal/jobs.hpp
+@brief Data-parallel work over components, scheduled on the same executor as flows.
+*/
+namespace dynamo
+{
+    /**
+    @brief A piece of work, processing a contiguous range of entities of one table.
+    */
+    using JobChunk = std::function<void()>;
+
+    /**
+    @brief Singleton holding every registered job.
+
+    A job is a kernel applied to contiguous component columns. It must not make structural changes,
+    so its chunks can run on any thread while the world is not progressing. Entities' components are
+    written in place, without going through a stage.
+
+    When a @c Simulation owns the world, jobs are split into chunks and run on its executor, after
+    @c world.progress(...), and optionally while flows are running. Otherwise, the "Jobs" system of
+    @c module::Core runs them inline, during @c PreUpdate.
+    */
+    struct Jobs
+    {
+        struct Job
+        {
+            std::string name {};
+
+            /**
+            @brief Called on the main thread to split the job into chunks for this tick.
+            */
+            std::function<void(float, size_t, std::vector<JobChunk>&)> split {};
+
+            /**
+            @brief If @c true, the job runs concurrently with flows. Only set it if flows do not read
+            the components written by this job.
+            */
+            bool overlap_flows {false};
+
+            bool enabled {true};
+        };
+
+        std::vector<Job> jobs {};
+
+        /**
+        @brief Maximum number of entities per chunk.
+        */
+        size_t grain {4096};
+
+        /**
+        @brief Set by the scheduler running jobs (e.g a @c Simulation), so that they are not run inline.
+        */
+        bool scheduled {false};
+
+        /**
+        @brief Split every enabled job (whose @c overlap_flows matches @c overlapping) into @c chunks.
+        */
+        void split(float delta_time, bool overlapping, std::vector<JobChunk>& chunks) const
+        {
+            for (const auto& job : jobs)
+            {
+                if (job.enabled && job.overlap_flows == overlapping)
+                    job.split(delta_time, grain, chunks);
+            }
+        }
+    };
+
+    namespace detail
+    {
+        /**
+        @brief Returns @c true if every term of @c it is owned by the entities of the table. An inherited term
+        (e.g through @c IsA) is a single shared value, not a column of @c it.count() elements.
+        */
+        template<size_t ... Is>
+        bool owns_terms(flecs::iter& it, std::index_sequence<Is...>)
+        {
+            return (it.is_owned(static_cast<int32_t>(Is + 1)) && ...);
+        }
+    }
+
+    /**
+    @brief Register a job applying @c kernel to every entity having components @c Ts ..., e.g :
+
+    @code{.cpp}
+    job<Stress>(world, "Stress_Decay", [](float dt, size_t count, Stress* stress) {
+        for (size_t i = 0; i < count; i++)
+            stress[i].value -= dt;
+    });
+    @endcode
+
+    Only owned components are processed : tables inheriting one of @c Ts (e.g through @c IsA) are skipped.
+    Returns the index of the job in @c Jobs::jobs.
+
+    @tparam F Accept function with following signature : @c std::function<void(float, size_t, Ts* ...)>
+    */
+    template<typename ... Ts, typename F>
+    size_t job(flecs::world& world, const char* name, F&& kernel, bool overlap_flows = false)
+    {
+        auto query = world.query<Ts...>();
+        auto jobs = world.get_mut<Jobs>();
+        jobs->jobs.push_back({
+            name,
+            [query, kernel = std::forward<F>(kernel)](float delta_time, size_t grain, std::vector<JobChunk>& chunks) mutable
+            {
+                query.iter([&](flecs::iter& it, Ts* ... columns)
+                    {
+                        if (!detail::owns_terms(it, std::index_sequence_for<Ts...>{}))
+                            return;
+                        const size_t count = it.count();
+                        for (size_t offset = 0; offset < count; offset += grain)
+                        {
+                            chunks.emplace_back([kernel, delta_time, n = std::min(grain, count - offset), ... data = columns + offset]()
+                                {
+                                    kernel(delta_time, n, data ...);
+                                });
+                        }
+                    });
+            },
+            overlap_flows
+        });
+        return jobs->jobs.size() - 1;
+    }
+}
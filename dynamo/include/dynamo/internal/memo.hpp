@@ -0,0 +1,225 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <typeindex>
+#include <unordered_map>
+#include <vector>
+
+/**
+@file dynamo/internal/memo.hpp
+@brief Results of processes shared between agents computing the same thing.
+*/
+namespace dynamo
+{
+    /**
+    @class MemoCache
+
+    @brief Concurrent cache of strategy results, keyed on the strategy type and a hash of what the result depends on
+    (its inputs and, optionally, a key extracted from the agent, see @c Memoized).
+
+    Entries are spread over shards, each one protected by its own mutex, so that concurrent flows rarely wait for
+    each other. Entries can be valid for the current tick only (see @c advance()) or until they are evicted.
+    A shard is emptied of its outdated entries when full, and cleared if it is still full.
+
+    Entries are found by hash, then the full key they were computed from (e.g the inputs) is compared : two different
+    keys with the same hash are a miss, never a shared result.
+    */
+    class MemoCache
+    {
+    public:
+        struct Stats
+        {
+            size_t hits {0};
+            size_t misses {0};
+
+            inline double hit_rate() const { return hits + misses ? static_cast<double>(hits) / (hits + misses) : 0.; }
+        };
+
+    private:
+        struct Key
+        {
+            std::type_index strategy;
+            size_t          hash;
+
+            bool operator==(const Key&) const = default;
+        };
+
+        struct KeyHash
+        {
+            size_t operator()(const Key& key) const
+            {
+                return key.strategy.hash_code() ^ (key.hash + 0x9e3779b97f4a7c15ULL + (key.hash << 6) + (key.hash >> 2));
+            }
+        };
+
+        template<typename T, typename TKey>
+        struct Memo
+        {
+            TKey    key;
+            T       value;
+        };
+
+        struct Entry
+        {
+            std::shared_ptr<const void> value;
+            std::uint64_t               epoch;
+            bool                        per_tick;
+        };
+
+        struct Shard
+        {
+            std::mutex mutex {};
+            std::unordered_map<Key, Entry, KeyHash> entries {};
+            std::unordered_map<std::type_index, Stats> stats {};
+        };
+
+    public:
+        /**
+        @brief Construct a cache with @c number_of_shards shards of at most @c capacity entries each.
+        */
+        explicit MemoCache(size_t number_of_shards = 64, size_t capacity = 4096) : shards(number_of_shards), capacity{ capacity } {}
+
+        /**
+        @brief Returns the result of @c strategy for @c key, whose hash is @c hash, @c nullptr if none.
+        @c T and @c TKey must be the output and key types @c strategy results are inserted with.
+        @param key Compared with the key of the entry found, e.g a tuple of references to the inputs.
+        @param per_tick If @c true, results computed during a previous tick are ignored.
+        */
+        template<typename T, typename TKey, typename TProbe>
+        std::shared_ptr<const T> find(std::type_index strategy, size_t hash, const TProbe& key, bool per_tick = true)
+        {
+            const Key id{ strategy, hash };
+            auto& shard = shard_of(id);
+            std::lock_guard lock{ shard.mutex };
+            auto& stats = shard.stats[strategy];
+            auto it = shard.entries.find(id);
+            if (it == shard.entries.end() || (per_tick && it->second.epoch != epoch()))
+            {
+                stats.misses++;
+                return nullptr;
+            }
+            auto memo = std::static_pointer_cast<const Memo<T, TKey>>(it->second.value);
+            if (!(memo->key == key)) // Same hash, different key
+            {
+                stats.misses++;
+                return nullptr;
+            }
+            stats.hits++;
+            return std::shared_ptr<const T>(memo, &memo->value);
+        }
+
+        /**
+        @brief Store @c value as the result of @c strategy for @c key, whose hash is @c hash.
+        @param per_tick If @c true, the entry can be evicted once the tick is over.
+        */
+        template<typename T, typename TKey>
+        void insert(std::type_index strategy, size_t hash, TKey key, T value, bool per_tick = true)
+        {
+            const Key id{ strategy, hash };
+            auto& shard = shard_of(id);
+            auto ptr = std::make_shared<const Memo<T, TKey>>(Memo<T, TKey>{ std::move(key), std::move(value) });
+            std::lock_guard lock{ shard.mutex };
+            if (shard.entries.size() >= capacity && !shard.entries.contains(id))
+                evict(shard);
+            shard.entries.insert_or_assign(id, Entry{ std::move(ptr), epoch(), per_tick });
+        }
+
+        /**
+        @brief Start a new tick : entries valid for one tick are outdated. Called by @c Simulation before flows run.
+        */
+        inline void advance() { _epoch.fetch_add(1, std::memory_order_relaxed); }
+
+        inline std::uint64_t epoch() const { return _epoch.load(std::memory_order_relaxed); }
+
+        /**
+        @brief Remove every entry, keeping statistics.
+        */
+        void clear()
+        {
+            for (auto& shard : shards)
+            {
+                std::lock_guard lock{ shard.mutex };
+                shard.entries.clear();
+            }
+        }
+
+        /**
+        @brief Number of hits and misses since the cache was created.
+        */
+        Stats stats() const
+        {
+            Stats total{};
+            for (auto& shard : shards)
+            {
+                std::lock_guard lock{ shard.mutex };
+                for (const auto& [_, stats] : shard.stats)
+                {
+                    total.hits += stats.hits;
+                    total.misses += stats.misses;
+                }
+            }
+            return total;
+        }
+
+        /**
+        @brief Number of hits and misses of results of @c strategy since the cache was created.
+        */
+        Stats stats(std::type_index strategy) const
+        {
+            Stats total{};
+            for (auto& shard : shards)
+            {
+                std::lock_guard lock{ shard.mutex };
+                if (auto it = shard.stats.find(strategy); it != shard.stats.end())
+                {
+                    total.hits += it->second.hits;
+                    total.misses += it->second.misses;
+                }
+            }
+            return total;
+        }
+
+        /**
+        @brief Number of entries, outdated ones included.
+        */
+        size_t size() const
+        {
+            size_t total = 0;
+            for (auto& shard : shards)
+            {
+                std::lock_guard lock{ shard.mutex };
+                total += shard.entries.size();
+            }
+            return total;
+        }
+
+    private:
+        inline Shard& shard_of(const Key& key) { return shards[KeyHash{}(key) % shards.size()]; }
+
+        void evict(Shard& shard)
+        {
+            std::erase_if(shard.entries, [current = epoch()](const auto& item)
+                {
+                    return item.second.per_tick && item.second.epoch != current;
+                });
+            if (shard.entries.size() >= capacity)
+                shard.entries.clear();
+        }
+
+    private:
+        mutable std::vector<Shard> shards;
+        size_t capacity;
+        std::atomic<std::uint64_t> _epoch {0};
+    };
+
+    /**
+    @brief Singleton giving access to the cache used by memoized processes.
+    */
+    struct Memoization
+    {
+        std::shared_ptr<MemoCache> cache { std::make_shared<MemoCache>() };
+    };
+}
@@ -0,0 +1,162 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <taskflow/taskflow.hpp>
+
+/**
+@file dynamo/internal/profiler.hpp
+@brief Measured durations of the tasks of flows, used to launch flows with the longest critical path first.
+*/
+namespace dynamo
+{
+    /**
+    @class FlowProfile
+
+    @brief Exponential moving averages of the duration (in milliseconds) of each task of a flow type, and the graph they form.
+    Tasks are identified by their index in @c tf::Taskflow::for_each_task(...), which is the same for every flow built by the same builder.
+    */
+    class FlowProfile
+    {
+    public:
+        explicit FlowProfile(tf::Taskflow& taskflow)
+        {
+            std::unordered_map<size_t, size_t> index {};
+            taskflow.for_each_task([&index](tf::Task task) { index.emplace(task.hash_value(), index.size()); });
+            successors.resize(index.size());
+            taskflow.for_each_task([this, &index](tf::Task task)
+                {
+                    auto& next = successors[index.at(task.hash_value())];
+                    task.for_each_successor([&next, &index](tf::Task successor) { next.push_back(index.at(successor.hash_value())); });
+                });
+            durations = std::make_unique<std::atomic<double>[]>(successors.size());
+        }
+
+        inline size_t size() const { return successors.size(); }
+
+        /**
+        @brief Add a measure of task @c task, weighted by @c alpha. Concurrent samples may be lost.
+        */
+        void sample(size_t task, double milliseconds, double alpha)
+        {
+            auto& average = durations[task];
+            const double previous = average.load(std::memory_order_relaxed);
+            average.store(previous == 0. ? milliseconds : previous + alpha * (milliseconds - previous), std::memory_order_relaxed);
+        }
+
+        inline double duration(size_t task) const { return durations[task].load(std::memory_order_relaxed); }
+
+        /**
+        @brief Returns the upward rank of the flow : the longest path from a source task to a sink, weighted by average durations.
+        Edges closing a loop (through condition tasks) are ignored.
+        */
+        double critical_path() const
+        {
+            enum class Mark : char { None, Visiting, Done };
+            std::vector<Mark> marks(size(), Mark::None);
+            std::vector<double> ranks(size(), 0.);
+
+            auto rank = [this, &marks, &ranks](auto&& self, size_t task) -> double
+            {
+                if (marks[task] == Mark::Done)
+                    return ranks[task];
+                if (marks[task] == Mark::Visiting)
+                    return 0.;
+                marks[task] = Mark::Visiting;
+                double longest = 0.;
+                for (auto successor : successors[task])
+                    longest = std::max(longest, self(self, successor));
+                marks[task] = Mark::Done;
+                return ranks[task] = duration(task) + longest;
+            };
+
+            double result = 0.;
+            for (size_t task = 0; task < size(); task++)
+                result = std::max(result, rank(rank, task));
+            return result;
+        }
+
+    private:
+        std::vector<std::vector<size_t>> successors {};
+        std::unique_ptr<std::atomic<double>[]> durations {};
+    };
+
+    /**
+    @brief Set on flow entities whose tasks are measured, see @c TaskProfiler.
+    */
+    struct Profile
+    {
+        std::shared_ptr<FlowProfile> value {};
+    };
+
+    /**
+    @class TaskProfiler
+
+    @brief Taskflow observer measuring tasks of tracked flows, and feeding their @c FlowProfile. Does nothing unless enabled.
+    */
+    class TaskProfiler : public tf::ObserverInterface
+    {
+        struct Slot
+        {
+            FlowProfile*    profile;
+            size_t          index;
+        };
+
+    public:
+        inline void set_up(size_t num_workers) override final
+        {
+            starts = std::make_unique<std::chrono::steady_clock::time_point[]>(num_workers);
+        }
+
+        inline void on_entry(tf::WorkerView w, tf::TaskView tv) override final
+        {
+            if (enabled.load(std::memory_order_relaxed))
+                starts[w.id()] = std::chrono::steady_clock::now();
+        }
+
+        inline void on_exit(tf::WorkerView w, tf::TaskView tv) override final
+        {
+            if (!enabled.load(std::memory_order_relaxed))
+                return;
+            const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - starts[w.id()];
+            std::shared_lock lock{ mutex };
+            if (auto it = slots.find(tv.hash_value()); it != slots.end())
+                it->second.profile->sample(it->second.index, elapsed.count(), alpha);
+        }
+
+        /**
+        @brief Measure tasks of @c taskflow into @c profile, which must have been built from a taskflow of the same shape.
+        */
+        void track(FlowProfile& profile, tf::Taskflow& taskflow)
+        {
+            std::unique_lock lock{ mutex };
+            size_t index = 0;
+            taskflow.for_each_task([this, &profile, &index](tf::Task task) { slots[task.hash_value()] = { &profile, index++ }; });
+        }
+
+        void untrack(tf::Taskflow& taskflow)
+        {
+            std::unique_lock lock{ mutex };
+            taskflow.for_each_task([this](tf::Task task) { slots.erase(task.hash_value()); });
+        }
+
+        inline void enable(bool value) { enabled.store(value, std::memory_order_relaxed); }
+
+        /**
+        @brief Weight of the last measure in moving averages.
+        */
+        double alpha {0.2};
+
+    private:
+        std::atomic<bool> enabled {false};
+        std::unique_ptr<std::chrono::steady_clock::time_point[]> starts {};
+        mutable std::shared_mutex mutex {};
+        std::unordered_map<size_t, Slot> slots {};
+    };
+}
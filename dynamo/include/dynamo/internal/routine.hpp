@@ -0,0 +1,428 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <coroutine>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <typeindex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <flecs.h>
+
+#include <dynamo/internal/types.hpp>
+#include <dynamo/utils/hash.hpp>
+
+/**
+@file dynamo/internal/routine.hpp
+@brief Coroutine processes, that can wait across ticks without holding a worker thread.
+
+Usage :
+
+@code{.cpp}
+// In a flow builder
+routine([](AgentHandle agent) -> Routine {
+    co_await ticks(agent, 5);               // Continue 5 ticks later
+    co_await perceived<Hearing>(agent);     // Wait for a percept, see listen<TSense>(...)
+    co_await changed<Stress>(agent);        // Wait for a change, see snapshot<T>(...)
+    agent.add<Calm>();
+});
+@endcode
+*/
+namespace dynamo {
+
+    class Routine;
+    struct RoutineSlot;
+
+    namespace detail {
+        /**
+        @brief Slot of the routine running on this thread, if any, see @c RoutineSlot::resume(...).
+        */
+        inline thread_local RoutineSlot* running_slot = nullptr;
+    }
+
+    /**
+    @class RoutineScheduler
+
+    @brief Holds suspended routines, with the condition to resume each of them.
+
+    Routines suspend themselves from any thread. Conditions are checked on the main thread by @c poll(), once per step,
+    before flows are launched. Ready routines are then resumed on the executor by the simulation.
+    */
+    class RoutineScheduler
+    {
+    public:
+        struct Wait
+        {
+            std::coroutine_handle<>                         handle;
+            std::shared_ptr<RoutineSlot>                    slot;
+            flecs::entity                                   agent;
+            std::function<bool(const RoutineScheduler&)>    ready;
+        };
+
+        /**
+        @brief Suspend a routine until @c wait.ready returns @c true. Thread-safe.
+        */
+        void suspend(Wait wait)
+        {
+            std::lock_guard lock{ mutex };
+            waits.push_back(std::move(wait));
+        }
+
+        /**
+        @brief Move routines that are ready into @c ready. Routines and percept counts of dead agents are dropped. Main thread only.
+        */
+        void poll(std::vector<Wait>& ready)
+        {
+            std::lock_guard lock{ mutex };
+            std::erase_if(perceptions, [](const auto& entry) { return !entry.second.agent.is_alive(); });
+            std::erase_if(waits, [this, &ready](Wait& wait)
+                {
+                    if (!wait.agent.is_alive())
+                        return true;
+                    if (!wait.ready(*this))
+                        return false;
+                    ready.push_back(std::move(wait));
+                    return true;
+                });
+        }
+
+        /**
+        @brief Start a new tick of @c delta_time seconds. Main thread only.
+        */
+        void advance(float delta_time)
+        {
+            _tick.fetch_add(1, std::memory_order_relaxed);
+            _time.store(_time.load(std::memory_order_relaxed) + delta_time, std::memory_order_relaxed);
+        }
+
+        inline std::uint64_t tick() const { return _tick.load(std::memory_order_relaxed); }
+
+        /**
+        @brief Simulated time (in seconds) since the scheduler was created.
+        */
+        inline double time() const { return _time.load(std::memory_order_relaxed); }
+
+        /**
+        @brief Count a percept of sense @c sense perceived by @c agent.
+        */
+        void perceived(flecs::entity agent, std::type_index sense)
+        {
+            std::lock_guard lock{ mutex };
+            auto& perception = perceptions[{ agent.id(), sense }];
+            perception.agent = agent;
+            perception.count++;
+        }
+
+        /**
+        @brief Number of percepts of sense @c sense perceived by @c agent so far, counted if @c sense is listened to.
+        */
+        size_t perceived_count(flecs::entity_t agent, std::type_index sense) const
+        {
+            std::lock_guard lock{ mutex };
+            auto it = perceptions.find({ agent, sense });
+            return it == perceptions.end() ? 0 : it->second.count;
+        }
+
+        /**
+        @brief Record the exception a routine ended with. Thread-safe.
+        */
+        void fail(std::exception_ptr error)
+        {
+            std::lock_guard lock{ mutex };
+            errors.push_back(std::move(error));
+        }
+
+        /**
+        @brief Exceptions routines ended with, oldest first. These routines are done and can be started again.
+        */
+        std::vector<std::exception_ptr> failures() const
+        {
+            std::lock_guard lock{ mutex };
+            return errors;
+        }
+
+        /**
+        @brief Number of suspended routines.
+        */
+        size_t size() const
+        {
+            std::lock_guard lock{ mutex };
+            return waits.size();
+        }
+
+    private:
+        /**
+        @brief Identifies the percepts of one sense perceived by one agent.
+        */
+        struct PerceptionKey
+        {
+            flecs::entity_t agent {0};
+            std::type_index sense {typeid(void)};
+
+            bool operator==(const PerceptionKey&) const = default;
+
+            struct Hash
+            {
+                size_t operator()(const PerceptionKey& key) const { return hash_of(key.agent, key.sense); }
+            };
+        };
+
+        struct Perceptions
+        {
+            flecs::entity agent {};
+            size_t count {0};
+        };
+
+        mutable std::recursive_mutex mutex {};
+        std::vector<Wait> waits {};
+        std::vector<std::exception_ptr> errors {};
+        std::unordered_map<PerceptionKey, Perceptions, PerceptionKey::Hash> perceptions {};
+        std::atomic<std::uint64_t> _tick {0};
+        std::atomic<double> _time {0.};
+    };
+
+    /**
+    @brief Singleton giving access to the routine scheduler.
+    */
+    struct Routines
+    {
+        std::shared_ptr<RoutineScheduler> scheduler { std::make_shared<RoutineScheduler>() };
+    };
+
+    /**
+    @class Routine
+
+    @brief Return type of a coroutine process. It starts when its task runs, and is resumed by the simulation
+    when the condition it awaits holds, see @c ticks(...), @c seconds(...), @c perceived<TSense>(...) and @c changed<T>(...).
+    */
+    class Routine
+    {
+    public:
+        struct promise_type
+        {
+            std::weak_ptr<RoutineSlot> slot {};
+
+            /**
+            @brief Exception the routine ended with, reported to the scheduler by @c FinalAwaiter.
+            */
+            std::exception_ptr exception {};
+
+            /**
+            @brief Mark its slot as free once suspended for the last time, so that the routine can be started again,
+            and report the exception it ended with, if any.
+            */
+            struct FinalAwaiter
+            {
+                bool await_ready() const noexcept { return false; }
+                void await_suspend(std::coroutine_handle<promise_type> handle) noexcept;
+                void await_resume() const noexcept {}
+            };
+
+            Routine get_return_object() { return Routine{ std::coroutine_handle<promise_type>::from_promise(*this) }; }
+
+            /**
+            @brief Suspended until its slot is set.
+            */
+            std::suspend_always initial_suspend() noexcept { return {}; }
+
+            /**
+            @brief Kept suspended once done, frame is destroyed by its owner.
+            */
+            FinalAwaiter final_suspend() noexcept { return {}; }
+
+            void return_void() {}
+            /**
+            @brief The routine ends : rethrowing would skip @c final_suspend() and leave its slot in flight forever.
+            */
+            void unhandled_exception() { exception = std::current_exception(); }
+        };
+
+        using handle_type = std::coroutine_handle<promise_type>;
+
+        Routine() = default;
+        explicit Routine(handle_type handle) : handle{ handle } {}
+        Routine(Routine&& other) noexcept : handle{ std::exchange(other.handle, {}) } {}
+        Routine& operator=(Routine&& other) noexcept
+        {
+            if (this != &other)
+            {
+                if (handle)
+                    handle.destroy();
+                handle = std::exchange(other.handle, {});
+            }
+            return *this;
+        }
+        Routine(const Routine&) = delete;
+        Routine& operator=(const Routine&) = delete;
+        ~Routine()
+        {
+            if (handle)
+                handle.destroy();
+        }
+
+        inline bool done() const { return handle && handle.done(); }
+
+    private:
+        friend struct RoutineSlot;
+
+        handle_type handle {};
+    };
+
+    /**
+    @brief Owns the coroutine frame of a routine. Shared by the task starting it and the scheduler while it is suspended.
+    */
+    struct RoutineSlot
+    {
+        Routine routine {};
+
+        /**
+        @brief @c true from the start of the routine until it is done.
+        */
+        std::atomic<bool> in_flight {false};
+
+        /**
+        @brief Where exceptions the routine ends with are reported, see @c RoutineScheduler::failures().
+        */
+        std::weak_ptr<RoutineScheduler> scheduler {};
+
+        /**
+        @brief Start a routine with @c factory, unless the previous one is still in flight (running or suspended).
+        Returns @c true if started.
+        */
+        template<typename F>
+        static bool start(const std::shared_ptr<RoutineSlot>& slot, F&& factory)
+        {
+            if (slot->in_flight.exchange(true, std::memory_order_acq_rel))
+                return false;
+            slot->routine = factory();
+            slot->routine.handle.promise().slot = slot;
+            resume(slot, slot->routine.handle);
+            return true;
+        }
+
+        /**
+        @brief Resume @c handle, a routine owned by @c slot. While it runs, awaiters find their scheduler through
+        the slot instead of reading the live world.
+        */
+        static void resume(const std::shared_ptr<RoutineSlot>& slot, std::coroutine_handle<> handle)
+        {
+            auto previous = std::exchange(detail::running_slot, slot.get());
+            handle.resume();
+            detail::running_slot = previous;
+        }
+    };
+
+    inline void Routine::promise_type::FinalAwaiter::await_suspend(std::coroutine_handle<promise_type> handle) noexcept
+    {
+        // Frame is not touched once the slot is released : it may be destroyed right away by the next start.
+        auto& promise = handle.promise();
+        if (auto slot = promise.slot.lock())
+        {
+            if (promise.exception)
+            {
+                if (auto scheduler = slot->scheduler.lock())
+                    scheduler->fail(promise.exception);
+            }
+            slot->in_flight.store(false, std::memory_order_release);
+        }
+    }
+
+    /**
+    @brief Awaitable suspending a routine until @c ready returns @c true.
+    */
+    struct RoutineAwaiter
+    {
+        AgentHandle agent;
+        std::function<bool(const RoutineScheduler&)> ready;
+        std::shared_ptr<RoutineScheduler> scheduler;
+
+        bool await_ready() const { return !scheduler || ready(*scheduler); }
+
+        void await_suspend(Routine::handle_type handle)
+        {
+            scheduler->suspend({ handle, handle.promise().slot.lock(), agent.entity(), std::move(ready) });
+        }
+
+        void await_resume() const noexcept {}
+    };
+
+    namespace detail {
+        inline std::shared_ptr<RoutineScheduler> scheduler_of(const AgentHandle& agent)
+        {
+            if (running_slot)
+                return running_slot->scheduler.lock();
+            assert(!world_progressing && "Routines can only wait from a routine process in pipelined mode.");
+            auto routines = agent.entity().world().get<Routines>();
+            return routines ? routines->scheduler : nullptr;
+        }
+    }
+
+    /**
+    @brief Wait for @c n steps.
+    */
+    inline RoutineAwaiter ticks(AgentHandle agent, std::uint64_t n)
+    {
+        auto scheduler = detail::scheduler_of(agent);
+        const auto target = (scheduler ? scheduler->tick() : 0) + n;
+        return { agent, [target](const RoutineScheduler& s) { return s.tick() >= target; }, scheduler };
+    }
+
+    /**
+    @brief Wait for @c duration seconds of simulated time.
+    */
+    inline RoutineAwaiter seconds(AgentHandle agent, double duration)
+    {
+        auto scheduler = detail::scheduler_of(agent);
+        const auto target = (scheduler ? scheduler->time() : 0.) + duration;
+        return { agent, [target](const RoutineScheduler& s) { return s.time() >= target; }, scheduler };
+    }
+
+    /**
+    @brief Wait until the agent perceives a new percept of sense @c TSense. @c TSense must be listened to, see @c listen<TSense>(...).
+    */
+    template<typename TSense>
+    RoutineAwaiter perceived(AgentHandle agent)
+    {
+        auto scheduler = detail::scheduler_of(agent);
+        const auto id = agent.entity().id();
+        const auto count = scheduler ? scheduler->perceived_count(id, typeid(TSense)) : 0;
+        return { agent, [id, count](const RoutineScheduler& s) { return s.perceived_count(id, typeid(TSense)) > count; }, scheduler };
+    }
+
+    /**
+    @brief Wait until component @c T of the agent changes. @c T should be flow-readable, see @c snapshot<T>(...).
+    */
+    template<typename T>
+    RoutineAwaiter changed(AgentHandle agent)
+    {
+        const auto version = agent.version<T>();
+        return { agent, [agent, version](const RoutineScheduler&) { return agent.version<T>() != version; }, detail::scheduler_of(agent) };
+    }
+
+    /**
+    @brief Count percepts of sense @c TSense perceived by each agent, so that routines can wait for them.
+    Must be called before routines wait for @c TSense.
+    */
+    template<typename TSense>
+    void listen(flecs::world& world)
+    {
+        world.observer<>()
+            .term<perceive>().obj(flecs::Wildcard)
+            .event(flecs::OnAdd)
+            .iter([scheduler = world.get<Routines>()->scheduler](flecs::iter& it)
+                {
+                    auto percept = it.id(1).object();
+                    if (!percept.has<TSense>())
+                        return;
+                    for (auto i : it)
+                        scheduler->perceived(it.entity(i), typeid(TSense));
+                }
+        );
+    }
+}
@@ -0,0 +1,230 @@
+#pragma once
+
+#include <atomic>
+#include <concepts>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <type_traits>
+#include <typeindex>
+#include <unordered_map>
+#include <vector>
+
+#include <flecs.h>
+
+/**
+@file dynamo/internal/snapshot.hpp
+@brief Double-buffered copies of components, read by flows instead of the live world.
+*/
+namespace dynamo
+{
+    /**
+    @class SnapshotRegistry
+
+    @brief Holds, for each registered component, a copy of its values taken at the start of reasoning.
+
+    Each component has two pages : flows read the front page while the next capture writes the back page,
+    then pages are flipped. Flows can therefore read registered components while the world is progressing
+    or while commands are applied, as long as a capture does not start before they are done reading the
+    previous one.
+
+    Components must be registered before flows run, see @c snapshot<T>(...). Only agents' components are captured.
+    */
+    class SnapshotRegistry
+    {
+        struct BufferBase
+        {
+            virtual ~BufferBase() = default;
+            virtual void capture(size_t page, std::uint64_t capture) = 0;
+        };
+
+        template<typename T>
+        struct Buffer : BufferBase
+        {
+            using Index = std::unordered_map<flecs::entity_t, std::uint32_t>;
+            static constexpr std::uint32_t none = std::numeric_limits<std::uint32_t>::max();
+
+            struct Page
+            {
+                std::vector<T> values {};
+
+                /**
+                @brief Capture at which each value last changed.
+                */
+                std::vector<std::uint64_t> versions {};
+
+                /**
+                @brief Captured entities, in iteration order.
+                */
+                std::vector<flecs::entity_t> ids {};
+
+                /**
+                @brief Shared by both pages while the captured entities do not change, so it is only rebuilt on structural changes.
+                */
+                std::shared_ptr<const Index> index { std::make_shared<const Index>() };
+            };
+
+            Buffer(flecs::world& world, flecs::entity_t scope) :
+                query{ scope ? world.query_builder<>().term<T>().term(scope).build() : world.query_builder<>().term<T>().build() }
+            {}
+
+            void capture(size_t page, std::uint64_t capture) override
+            {
+                auto& p = pages[page];
+                const auto& previous = pages[1 - page];
+                p.values.clear();
+                p.versions.clear();
+                p.ids.clear();
+                query.iter([&p, &previous, capture](flecs::iter& it)
+                    {
+                        // An inherited component (e.g through IsA) is a single value shared by every row.
+                        const bool owned = it.is_owned(1);
+
+                        for (auto i : it)
+                        {
+                            const auto id = it.entity(i).id();
+                            const auto n = p.ids.size();
+                            // While entities are captured in the same order, their previous slot is their position.
+                            std::uint32_t last = none;
+                            if (n < previous.ids.size() && previous.ids[n] == id)
+                                last = static_cast<std::uint32_t>(n);
+                            else if (auto found = previous.index->find(id); found != previous.index->end())
+                                last = found->second;
+                            std::uint64_t version = capture;
+
+                            if constexpr (std::is_empty_v<T>)
+                            {
+                                if (last != none)
+                                    version = previous.versions[last];
+                            }
+                            else
+                            {
+                                const auto& value = it.term<const T>(1)[owned ? i : 0];
+                                // Values that cannot be compared are considered changed at every capture.
+                                if constexpr (std::equality_comparable<T>)
+                                {
+                                    if (last != none && previous.values[last] == value)
+                                        version = previous.versions[last];
+                                }
+                                p.values.push_back(value);
+                            }
+
+                            p.ids.push_back(id);
+                            p.versions.push_back(version);
+                        }
+                    });
+
+                if (p.ids == previous.ids)
+                {
+                    p.index = previous.index;
+                    return;
+                }
+                auto index = std::make_shared<Index>();
+                index->reserve(p.ids.size());
+                for (std::uint32_t i = 0; i < p.ids.size(); i++)
+                    index->emplace(p.ids[i], i);
+                p.index = std::move(index);
+            }
+
+            flecs::query<> query;
+            Page pages[2] {};
+        };
+
+    public:
+        /**
+        @brief Register component @c T, only captured on entities having @c scope (if not 0). Does nothing if already registered.
+        Inherited components (e.g through @c IsA) are captured as a copy per entity.
+        */
+        template<typename T>
+        void add(flecs::world& world, flecs::entity_t scope = 0)
+        {
+            if (!contains<T>())
+                buffers.emplace(typeid(T), std::make_unique<Buffer<T>>(world, scope));
+        }
+
+        template<typename T>
+        bool contains() const
+        {
+            return buffers.contains(typeid(T));
+        }
+
+        /**
+        @brief Returns @c true if entity @c e had component @c T at the last capture.
+        */
+        template<typename T>
+        bool has(flecs::entity_t e) const
+        {
+            const auto& page = buffer<T>().pages[front.load(std::memory_order_acquire)];
+            return page.index->contains(e);
+        }
+
+        /**
+        @brief Returns the value of component @c T of entity @c e at the last capture, @c nullptr if it had none.
+        */
+        template<typename T>
+        const T* get(flecs::entity_t e) const
+        {
+            const auto& page = buffer<T>().pages[front.load(std::memory_order_acquire)];
+            auto it = page.index->find(e);
+            return it == page.index->end() ? nullptr : &page.values[it->second];
+        }
+
+        /**
+        @brief Returns the capture at which component @c T of entity @c e last changed, 0 if it had none.
+        Values are compared with @c operator== if available, otherwise they change at every capture.
+        */
+        template<typename T>
+        std::uint64_t version(flecs::entity_t e) const
+        {
+            const auto& page = buffer<T>().pages[front.load(std::memory_order_acquire)];
+            auto it = page.index->find(e);
+            return it == page.index->end() ? 0 : page.versions[it->second];
+        }
+
+        /**
+        @brief Copy every registered component into the back pages, then flip pages. Main thread only.
+        */
+        void capture()
+        {
+            const size_t back = 1 - front.load(std::memory_order_relaxed);
+            for (auto& [_, buffer] : buffers)
+                buffer->capture(back, captures + 1);
+            front.store(back, std::memory_order_release);
+            captures++;
+        }
+
+        /**
+        @brief Number of captures done so far.
+        */
+        inline size_t version() const { return captures; }
+
+    private:
+        template<typename T>
+        const Buffer<T>& buffer() const
+        {
+            return static_cast<const Buffer<T>&>(*buffers.at(typeid(T)));
+        }
+
+    private:
+        std::unordered_map<std::type_index, std::unique_ptr<BufferBase>> buffers {};
+        std::atomic<size_t> front {0};
+        size_t captures {0};
+    };
+
+    /**
+    @brief Singleton giving access to the snapshot registry.
+    */
+    struct Snapshots
+    {
+        std::shared_ptr<SnapshotRegistry> registry { std::make_shared<SnapshotRegistry>() };
+    };
+
+    namespace detail
+    {
+        /**
+        @brief @c true on executor threads while the world may be progressing at the same time (see @c StepMode::Pipelined).
+        Helpers reading the live world assert it is unset : from flows, only snapshots can be read safely.
+        */
+        inline thread_local bool world_progressing = false;
+    }
+}
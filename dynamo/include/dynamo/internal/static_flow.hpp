@@ -0,0 +1,200 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <typeinfo>
+#include <utility>
+
+#include <dynamo/internal/flow.hpp>
+
+/**
+@file dynamo/internal/static_flow.hpp
+@brief Flows whose processes and edges are types, ordered at compile time.
+
+Usage :
+
+@code{.cpp}
+// I - Declare processes, with their strategy, their output and the processes they take as inputs
+struct Feasible : StaticProcess<strat::ContainerAccumulator, std::vector<flecs::entity>> {};
+struct Selection : StaticProcess<strat::InfluenceGraph, flecs::entity, Feasible> {};
+
+// II - Declare the flow, processes can be listed in any order
+class MyFlow : public StaticFlowBuilder<StaticFlow<Selection, Feasible>>
+{
+public:
+    using StaticFlowBuilder::StaticFlowBuilder;
+    virtual constexpr const char* name() const { return "MyFlow"; }
+};
+
+// III - Use it like any other flow
+sim.flow<MyFlow>();
+@endcode
+*/
+namespace dynamo {
+
+    /**
+    @brief A process of a @c StaticFlow : its strategy @c T computes a @c TOutput from the outputs of processes @c TInputs.
+    */
+    template<template<typename, typename ...> typename T, typename TOutput, typename ... TInputs>
+    struct StaticProcess
+    {
+        using output    = TOutput;
+        using strategy  = T<TOutput, typename TInputs::output ...>;
+        using inputs    = std::tuple<TInputs ...>;
+    };
+
+    namespace detail {
+        template<typename TProcess, typename = typename TProcess::inputs>
+        struct depth;
+
+        /**
+        @brief Length of the longest path from a process without inputs to @c TProcess.
+        */
+        template<typename TProcess, typename ... TInputs>
+        struct depth<TProcess, std::tuple<TInputs ...>>
+        {
+            static constexpr size_t value = std::max({ size_t{ 0 }, (depth<TInputs>::value + 1) ... });
+        };
+
+        template<typename T, typename ... Ts>
+        constexpr size_t index_of()
+        {
+            constexpr std::array<bool, sizeof...(Ts)> same{ std::is_same_v<T, Ts> ... };
+            for (size_t i = 0; i < same.size(); i++)
+                if (same[i])
+                    return i;
+            return sizeof...(Ts);
+        }
+    }
+
+    /**
+    @class StaticFlow
+
+    @brief A flow made of processes @c TProcesses (see @c StaticProcess), whose outputs are stored in a @c Frame.
+
+    The topological order is computed at compile time, and processes are run with static dispatch : no
+    type erasure, no hash maps and no allocation per process.
+    */
+    template<typename ... TProcesses>
+    class StaticFlow
+    {
+    public:
+        using Processes = std::tuple<TProcesses ...>;
+
+        /**
+        @brief Outputs of all processes, for one agent.
+        */
+        using Frame = std::tuple<typename TProcesses::output ...>;
+
+        static constexpr size_t size = sizeof...(TProcesses);
+
+        /**
+        @brief Index of @c TProcess in the flow, and of its output in a @c Frame.
+        */
+        template<typename TProcess>
+        static constexpr size_t index = detail::index_of<TProcess, TProcesses ...>();
+
+        /**
+        @brief Indices of the inputs of the process at index @c I.
+        */
+        template<size_t I>
+        static constexpr auto inputs = []<typename ... TInputs>(std::tuple<TInputs ...>*) {
+            return std::array<size_t, sizeof...(TInputs)>{ index<TInputs> ... };
+        }(static_cast<typename std::tuple_element_t<I, Processes>::inputs*>(nullptr));
+
+        static constexpr std::array<size_t, size> depths{ detail::depth<TProcesses>::value ... };
+
+        /**
+        @brief Indices of processes in topological order : by depth, then by declaration order.
+        */
+        static constexpr std::array<size_t, size> order = []() {
+            std::array<size_t, size> result{};
+            size_t k = 0;
+            for (size_t d = 0; k < size; d++)
+                for (size_t i = 0; i < size; i++)
+                    if (depths[i] == d)
+                        result[k++] = i;
+            return result;
+        }();
+
+        /**
+        @brief @c true if processes can only run one after the other (i.e there is one process per depth).
+        */
+        static constexpr bool sequential = []() {
+            std::array<size_t, size> width{};
+            for (auto d : depths)
+                if (++width[d] > 1)
+                    return false;
+            return true;
+        }();
+
+        /**
+        @brief Compute the process at index @c I for @c agent, from the outputs of its inputs stored in @c frame.
+        */
+        template<size_t I>
+        static void run_process(const Strategies& strategies, AgentHandle agent, Frame& frame)
+        {
+            using TProcess = std::tuple_element_t<I, Processes>;
+            [&]<typename ... TInputs>(std::tuple<TInputs ...>*) {
+                static_assert(((index<TInputs> < size) && ...), "Inputs of a process must be processes of the flow.");
+                std::get<I>(frame) = strategies.get<typename TProcess::strategy>()(agent, std::get<index<TInputs>>(frame) ...);
+            }(static_cast<typename TProcess::inputs*>(nullptr));
+        }
+
+        /**
+        @brief Compute all processes for @c agent, in topological order.
+        */
+        static void run(const Strategies& strategies, AgentHandle agent, Frame& frame)
+        {
+            [&]<size_t ... K>(std::index_sequence<K ...>) {
+                (run_process<order[K]>(strategies, agent, frame), ...);
+            }(std::make_index_sequence<size>{});
+        }
+    };
+
+    /**
+    @class StaticFlowBuilder
+
+    @brief Flow builder for a @c StaticFlow, so that it can be used like any other flow.
+
+    A sequential flow is run as a single task. Otherwise, each process gets a task, linked to its inputs,
+    and linear chains are fused (see @c FlowBuilder::fuse()) : Taskflow only schedules what can run in parallel.
+    */
+    template<typename TFlow>
+    class StaticFlowBuilder : public FlowBuilder
+    {
+    public:
+        using FlowBuilder::FlowBuilder;
+
+        void build() override
+        {
+            if constexpr (TFlow::sequential)
+            {
+                auto task = emplace([s = strategies, f = frame](AgentHandle agent) { TFlow::run(*s, agent, *f); });
+                task.name(name());
+            }
+            else
+            {
+                std::array<tf::Task, TFlow::size> tasks{};
+                [&]<size_t ... I>(std::index_sequence<I ...>) {
+                    ((tasks[I] = emplace([s = strategies, f = frame](AgentHandle agent) {
+                        TFlow::template run_process<I>(*s, agent, *f);
+                    })), ...);
+                    (tasks[I].name(typeid(std::tuple_element_t<I, typename TFlow::Processes>).name()), ...);
+                    ([&tasks]() {
+                        for (auto input : TFlow::template inputs<I>)
+                            tasks[I].succeed(tasks[input]);
+                    }(), ...);
+                }(std::make_index_sequence<TFlow::size>{});
+            }
+        }
+
+        /**
+        @brief Outputs of the processes for this agent. Read @c std::get<TFlow::template index<TProcess>>(*frame).
+        */
+        std::shared_ptr<typename TFlow::Frame> frame{ std::make_shared<typename TFlow::Frame>() };
+    };
+}
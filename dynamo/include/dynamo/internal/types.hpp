@@ -1,11 +1,15 @@
 #pragma once
 
+#include <algorithm>
+#include <cassert>
 #include <iostream>
+#include <vector>
 
 #include <flecs.h>
 
 #include <dynamo/internal/components.hpp>
 #include <dynamo/internal/relations.hpp>
+#include <dynamo/internal/snapshot.hpp>
 
 /**
 @file dynamo/internal/types.hpp
@@ -44,6 +48,18 @@ namespace dynamo::type {
     struct Percept {};
 }
 
+namespace dynamo {
+    /**
+    @brief Make component @c T flow-readable : @c AgentHandle reads it from a snapshot taken at the start of
+    reasoning, instead of the live world. Only components owned by agents are captured.
+    */
+    template<typename T>
+    void snapshot(flecs::world& world)
+    {
+        world.get<Snapshots>()->registry->add<T>(world, world.id<type::Agent>());
+    }
+}
+
 namespace dynamo {
     /**
     @class EntityWrapper
@@ -301,7 +317,7 @@ namespace dynamo {
                 {
                     if (e.has<Flow>())
                     {
-                        models.emplace_back(e.get<Flow>()->taskflow.dump());
+                        models.emplace_back(e.get<Flow>()->taskflow->dump());
                     }
                 }
             );
@@ -331,7 +347,56 @@ namespace dynamo {
         /**
         @brief Handle for manipulating agent where every modifications are deferred.
         */
-        explicit AgentHandle(flecs::entity entity) : DefferedEntityManipulator<AgentHandle>(entity) {};
+        explicit AgentHandle(flecs::entity entity) : DefferedEntityManipulator<AgentHandle>(entity)
+        {
+            if (auto snapshots = m_entity.world().get<Snapshots>())
+                snapshot = snapshots->registry;
+        };
+
+        /**
+        @brief Returns @c true or @c false, if has given component. Read from the snapshot if @c TType is flow-readable
+        (see @c dynamo::snapshot<T>(...)), from the live world otherwise.
+        @tparam TType Component's type.
+        */
+        template<typename TType>
+        bool has() const
+        {
+            if (snapshot && snapshot->contains<TType>())
+                return snapshot->has<TType>(m_entity.id());
+            return m_entity.has<TType>();
+        }
+
+        /**
+        @brief Returns a pointer to the const component. Read from the snapshot if @c TType is flow-readable
+        (see @c dynamo::snapshot<T>(...)), from the live world otherwise.
+        @tparam TType Component's type.
+        */
+        template<typename TType>
+        TType const* get() const
+        {
+            if (snapshot && snapshot->contains<TType>())
+                return snapshot->get<TType>(m_entity.id());
+            return m_entity.get<TType>();
+        }
+
+        /**
+        @brief Returns the capture at which component @c TType last changed (0 if the agent does not have it).
+        Changes of components that are not flow-readable are not tracked : the current capture is returned,
+        so they are considered changed at every step.
+        @tparam TType Component's type.
+        */
+        template<typename TType>
+        std::uint64_t version() const
+        {
+            if (!snapshot)
+                return 0;
+            if (snapshot->contains<TType>())
+                return snapshot->version<TType>(m_entity.id());
+            return snapshot->version();
+        }
+
+    private:
+        std::shared_ptr<const SnapshotRegistry> snapshot {};
     };
 
 
@@ -368,6 +433,78 @@ namespace dynamo {
             : EntityManipulator<Organisation>(entity) {};
     };
 
+    namespace detail {
+        /**
+        @brief Add (or remove, if @c add is @c false) @c delta to the @c PerceivedSources of every entity perceiving @c e,
+        directly or through a chain of percepts. Entities already on the chain are not visited again, so cycles terminate.
+        */
+        inline void propagate_closure(flecs::entity e, const PerceivedSources& delta, bool add, std::vector<flecs::entity_t>& chain)
+        {
+            auto perceivers = e.get<Perceivers>();
+            if (!perceivers)
+                return;
+
+            chain.push_back(e.id());
+            // Copied : a perceiver may be registered to an entity of the chain while iterating.
+            const auto entities = perceivers->entities;
+            for (auto id : entities)
+            {
+                auto perceiver = flecs::entity(e.world(), id);
+                if (!perceiver.is_alive() || std::find(chain.begin(), chain.end(), id) != chain.end())
+                    continue;
+                auto closure = perceiver.get_mut<PerceivedSources>();
+                if (add)
+                    closure->add(delta);
+                else
+                    closure->remove(delta);
+                propagate_closure(perceiver, delta, add, chain);
+            }
+            chain.pop_back();
+        }
+
+        /**
+        @brief Returns what an entity gains in its closure by perceiving @c e : @c e itself and everything it perceives.
+        */
+        inline PerceivedSources closure_through(flecs::entity e)
+        {
+            PerceivedSources delta{};
+            delta.add(e.id());
+            if (auto sources = e.get<PerceivedSources>())
+                delta.add(*sources);
+            return delta;
+        }
+
+        /**
+        @brief Add relation @c perceive from @c perceiver to @c perceived, and update the closures of @c perceiver
+        and of every entity perceiving it.
+        */
+        inline void link_perceive(flecs::entity perceiver, flecs::entity perceived)
+        {
+            if (perceiver.has<perceive>(perceived))
+                return;
+
+            perceiver.add<perceive>(perceived);
+            const auto delta = closure_through(perceived);
+            perceiver.get_mut<PerceivedSources>()->add(delta);
+            auto& perceivers = perceived.get_mut<Perceivers>()->entities;
+            std::erase_if(perceivers, [&perceived](flecs::entity_t id) { return !flecs::entity(perceived.world(), id).is_alive(); });
+            perceivers.push_back(perceiver.id());
+
+            std::vector<flecs::entity_t> chain{ perceived.id() };
+            propagate_closure(perceiver, delta, true, chain);
+        }
+
+        /**
+        @brief Update the closures of every entity perceiving @c perceived, about to be destroyed.
+        */
+        inline void unlink_perceived(flecs::entity perceived)
+        {
+            const auto delta = closure_through(perceived);
+            std::vector<flecs::entity_t> chain{};
+            propagate_closure(perceived, delta, false, chain);
+        }
+    }
+
     /**
     @class Percept
 
@@ -396,8 +533,7 @@ namespace dynamo {
         @param e entity perceiving this percept
         */
         Percept& perceived_by(flecs::entity e) {
-            e.mut(m_entity).add<perceive>(m_entity);
-            return *this;
+            return perceived_by_impl(e.mut(m_entity));
         }
 
         /**
@@ -407,8 +543,7 @@ namespace dynamo {
         @param e entity perceiving this percept
         */
         Percept& perceived_by(flecs::entity_view e) {
-            e.mut(m_entity).add<perceive>(m_entity);
-            return *this;
+            return perceived_by_impl(e.mut(m_entity));
         }
 
         /**
@@ -420,8 +555,41 @@ namespace dynamo {
             m_entity.set<Decay>({ ttl });
             return *this;
         }
+
+    private:
+        /**
+        @brief Add the relation and propagate this percept's @c PerceivedSources to @c e and its perceivers, once.
+        */
+        Percept& perceived_by_impl(flecs::entity e) {
+            detail::link_perceive(e, m_entity);
+            return *this;
+        }
     };
 
+    /**
+    @brief Returns @c true if @c e perceives @c target, directly or through a chain of percepts.
+
+    O(1) lookup in the materialized closure (see @c PerceivedSources), no relation traversal.
+    Reads the live world : from flows in pipelined mode, use the @c AgentHandle overload instead.
+    */
+    inline bool perceives(const flecs::entity_view& e, const flecs::entity_view& target)
+    {
+        assert(!detail::world_progressing && "perceives() reads the live world, use perceives(AgentHandle, ...) from flows.");
+        auto closure = e.get<PerceivedSources>();
+        return closure && closure->contains(target.id());
+    }
+
+    /**
+    @brief Returns @c true if @c agent perceived @c target at the last capture, directly or through a chain of percepts.
+
+    Safe from flows in pipelined mode if @c PerceivedSources is flow-readable, see @c dynamo::snapshot<T>(...).
+    */
+    inline bool perceives(const AgentHandle& agent, flecs::entity_t target)
+    {
+        auto closure = agent.get<PerceivedSources>();
+        return closure && closure->contains(target);
+    }
+
     /**
     @class Builder
 
@@ -553,8 +721,11 @@ namespace dynamo {
         */
         template <typename TSense>
         Percept source(flecs::entity e) {
+            // A percept perceives its source and, transitively, everything its source perceives :
+            // its closure follows the source's one, see @c detail::link_perceive(...).
+            detail::link_perceive(entity, e);
+
             return Percept(entity.add<::dynamo::source>(e)
-                .add<perceive>(e)
                 .add<TSense>());
         }
     };
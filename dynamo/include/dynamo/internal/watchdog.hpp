@@ -0,0 +1,85 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include <flecs.h>
+#include <taskflow/taskflow.hpp>
+
+/**
+@file dynamo/internal/watchdog.hpp
+@brief Records of flows cancelled for overrunning their deadline, see @c Deadline.
+*/
+namespace dynamo
+{
+    /**
+    @brief A flow cancelled because it overran its deadline.
+    */
+    struct FlowOverrun
+    {
+        flecs::entity_t agent {0};
+        flecs::entity_t flow {0};
+        std::string     flow_name {};
+
+        /**
+        @brief Names of the processes running when the flow was cancelled, separated by ", ". Empty if none was running
+        (e.g the flow was still waiting for a worker).
+        */
+        std::string     processes {};
+        std::chrono::duration<double, std::milli> deadline {0};
+        std::int64_t    tick {0};
+
+        /**
+        @brief @c true if the flow was still running one more @c deadline after being cancelled : its running task does not
+        check for cancellation (e.g the budget token), and the step was stalled until it returned.
+        */
+        bool            stalled {false};
+    };
+
+    /**
+    @class RunningTasks
+
+    @brief Taskflow observer keeping, for each worker, the hash of the task it is running (0 if none),
+    so that the watchdog can tell in which process an overrunning flow is stuck.
+    */
+    class RunningTasks : public tf::ObserverInterface
+    {
+    public:
+        inline void set_up(size_t num_workers) override final
+        {
+            size = num_workers;
+            running = std::make_unique<std::atomic<size_t>[]>(num_workers);
+        }
+
+        inline void on_entry(tf::WorkerView w, tf::TaskView tv) override final
+        {
+            running[w.id()].store(tv.hash_value(), std::memory_order_relaxed);
+        }
+
+        inline void on_exit(tf::WorkerView w, tf::TaskView tv) override final
+        {
+            running[w.id()].store(0, std::memory_order_relaxed);
+        }
+
+        /**
+        @brief Call @c func with the hash of each running task.
+        @tparam T Accept function with following signature : @c std::function<void(size_t)>
+        */
+        template<typename T>
+        void each(T&& func) const
+        {
+            for (size_t i = 0; i < size; i++)
+            {
+                if (auto hash = running[i].load(std::memory_order_relaxed))
+                    func(hash);
+            }
+        }
+
+    private:
+        size_t size {0};
+        std::unique_ptr<std::atomic<size_t>[]> running {};
+    };
+}
@@ -1,7 +1,24 @@
 #pragma once
 
+#include <algorithm>
+#include <cassert>
+#include <memory>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
 #include <flecs.h>
 
+#include <dynamo/algorithm/allocation.hpp>
+#include <dynamo/algorithm/task_tree.hpp>
+#include <dynamo/internal/types.hpp>
+#include <dynamo/modules/basic_action.hpp>
+#include <dynamo/utils/bitset.hpp>
+#include <dynamo/utils/containers.hpp>
+#include <dynamo/utils/mpsc_queue.hpp>
+
 namespace dynamo{
 
     namespace type{
@@ -42,56 +59,375 @@ namespace dynamo{
         struct feasible {};
     }
 
-    enum class LogicalConstructor : int
+    inline bool is_cooperative(const flecs::entity& e)
     {
-        AND = 0,
-        OR,
-        Undefined
-    };
+        return e.has<type::Arity>() && e.get<type::Arity>()->value > 1;
+    }
+
+    inline bool is_mastered(const flecs::entity& agent, const flecs::entity& action)
+    {
+        return agent.has<type::Qualification>() && (agent.get<type::Qualification>()->value >= action.get<type::Qualification>()->value);
+    }
+
+    /**
+    @brief Returns @c true if @c action has no precondition @c T or if its value is positive.
+    */
+    template<typename T>
+    inline bool precondition_holds(const flecs::entity& action)
+    {
+        return !action.has<T>() || action.get<T>()->value > 0;
+    }
+
+    /**
+    @brief Returns @c true if every precondition of @c action holds.
+    */
+    inline bool preconditions_hold(const flecs::entity& action)
+    {
+        return precondition_holds<type::PreCondition_Contextual>(action)
+            && precondition_holds<type::PreCondition_Nomological>(action)
+            && precondition_holds<type::PreCondition_Reglemantary>(action)
+            && precondition_holds<type::PreCondition_Favorable>(action);
+    }
 
     /**
-    @brief convert a logical constructor to a human-readable string
+    @brief Singleton where actions' qualifications and preconditions are compiled into flat arrays.
+
+    Columns are sorted by required qualification, so the actions mastered by an agent form a prefix.
+    Feasibility of all actions for an agent is then this prefix intersected with the precondition mask,
+    computed one 64-bit word at a time.
     */
-    inline const char* to_string(LogicalConstructor val)
+    struct FeasibilityMatrix
     {
-        switch (val)
+        /**
+        @brief Action of each column.
+        */
+        std::vector<flecs::entity>  actions {};
+
+        /**
+        @brief Qualification required by each column, in increasing order.
+        */
+        std::vector<int>            required {};
+
+        /**
+        @brief Arity of each column.
+        */
+        std::vector<int>            arity {};
+
+        /**
+        @brief Columns whose preconditions all hold.
+        */
+        DynamicBitset               preconditions {};
+
+        /**
+        @brief Incremented at each compilation, so agents know when to re-evaluate.
+        */
+        size_t                      version {0};
+
+        /**
+        @brief Set when an action, its qualification or one of its preconditions changed.
+        */
+        bool                        dirty {true};
+
+        /**
+        @brief Rebuild columns from all actions of @c world.
+        */
+        void compile(flecs::world& world)
+        {
+            std::vector<std::tuple<int, int, bool, flecs::entity>> columns {};
+            world.each<const type::Action>([&columns](flecs::entity e, const type::Action _) {
+                columns.emplace_back(
+                    e.has<type::Qualification>() ? e.get<type::Qualification>()->value : 0,
+                    e.has<type::Arity>() ? e.get<type::Arity>()->value : 1,
+                    preconditions_hold(e),
+                    e);
+            });
+            std::stable_sort(columns.begin(), columns.end(),
+                [](const auto& a, const auto& b) { return std::get<0>(a) < std::get<0>(b); });
+
+            actions.clear();
+            required.clear();
+            arity.clear();
+            preconditions.resize(0);
+            preconditions.resize(columns.size());
+            for (size_t i = 0; i < columns.size(); i++)
+            {
+                const auto& [qualification, n, holds, action] = columns[i];
+                required.push_back(qualification);
+                arity.push_back(n);
+                actions.push_back(action);
+                preconditions.set(i, holds);
+            }
+            version++;
+            dirty = false;
+        }
+
+        /**
+        @brief Write in @c out the columns feasible for an agent with given @c qualification.
+        */
+        void evaluate(int qualification, DynamicBitset& out) const
+        {
+            const size_t mastered = std::upper_bound(required.begin(), required.end(), qualification) - required.begin();
+            out = preconditions;
+            out.keep_first(mastered);
+        }
+
+        /**
+        @brief Call @c func with each action set in @c feasible.
+        @tparam F Accept function with following signature : @c std::function<void(flecs::entity)>
+        */
+        template<typename F>
+        void for_each(const DynamicBitset& feasible, F&& func) const
         {
-			case LogicalConstructor::AND:   return "AND";
-			case LogicalConstructor::OR:    return "OR";
-			default: return "Undefined";
+            feasible.for_each([this, &func](size_t column) { func(actions[column]); });
         }
+    };
+
+    /**
+    @brief Per-agent bitset of feasible actions, indexed by @c FeasibilityMatrix columns.
+    */
+    struct FeasibleActions
+    {
+        DynamicBitset   bits {};
+
+        /**
+        @brief Version of the matrix @c bits was computed with. 0 forces a re-evaluation.
+        */
+        size_t          version {0};
+    };
+
+    /**
+    @brief Call @c func with each action feasible for @c agent. Reads the live world : not callable from flows in pipelined mode.
+    @tparam F Accept function with following signature : @c std::function<void(flecs::entity)>
+    */
+    template<typename F>
+    void for_each_feasible(const flecs::entity& agent, F&& func)
+    {
+        assert(!detail::world_progressing && "for_each_feasible() reads the live world, it cannot be called from flows in pipelined mode.");
+        auto feasible = agent.get<FeasibleActions>();
+        if (feasible)
+            agent.world().get<FeasibilityMatrix>()->for_each(feasible->bits, std::forward<F>(func));
+    }
+
+    /**
+    @brief Position of a task or an action among its siblings in an activity tree. Set to the creation order
+    by @c module::ADL when the node is tagged, it can be overridden. Unlike entity ids, it is never recycled.
+    */
+    struct NodeOrder
+    {
+        std::uint64_t value {0};
+    };
+
+    /**
+    @brief Flatten the activity tree under @c root (a @c type::Root or @c type::Task entity).
+
+    Tasks and actions are found through @c ChildOf, ordered by @c NodeOrder (creation order by default). A task's
+    constructors are read from its @c LogicalConstructor and @c TemporalConstructor components (@c AND and @c IND by default).
+    */
+    inline TaskTree compile_task_tree(flecs::entity root)
+    {
+        TaskTree tree{};
+        auto visit = [&tree](flecs::entity node, auto& visit_ref) -> void
+        {
+            tree.open(node.id(),
+                node.has<LogicalConstructor>() ? *node.get<LogicalConstructor>() : LogicalConstructor::AND,
+                node.has<TemporalConstructor>() ? *node.get<TemporalConstructor>() : TemporalConstructor::IND,
+                !node.has<type::Action>() || preconditions_hold(node));
+
+            std::vector<flecs::entity> children{};
+            node.children([&children](flecs::entity child) {
+                if (child.has<type::Task>() || child.has<type::Action>())
+                    children.push_back(child);
+            });
+            // Nodes tagged before module::ADL was imported have no order, they come first.
+            auto order = [](const flecs::entity& e) { return std::make_pair(e.has<NodeOrder>() ? e.get<NodeOrder>()->value : 0, e.id()); };
+            std::sort(children.begin(), children.end(),
+                [&order](const flecs::entity& a, const flecs::entity& b) { return order(a) < order(b); });
+            for (auto child : children)
+                visit_ref(child, visit_ref);
+
+            tree.close();
+        };
+        visit(root, visit);
+        return tree;
     }
 
-    enum class TemporalConstructor : int
+    /**
+    @brief Component holding a flattened activity tree, set on its root.
+    */
+    struct CompiledTaskTree
     {
-        SEQ = 0,
-        SEQ_ORD,
-        IND,
-        Undefined
+        TaskTree tree {};
+
+        /**
+        @brief Incremented each time the tree is compiled.
+        */
+        std::uint64_t version {0};
     };
 
     /**
-    @brief convert a temporal constructor to a human-readable string
+    @brief Singleton of @c module::ADL keeping compiled activity trees in sync with their nodes.
     */
-    inline const char* to_string(TemporalConstructor val)
+    struct TaskTrees
     {
-        switch (val) 
+        /**
+        @brief Next value of @c NodeOrder.
+        */
+        std::uint64_t next_order {1};
+
+        /**
+        @brief Roots of compiled trees whose nodes, constructors or preconditions changed : they are compiled again
+        during the next tick.
+        */
+        std::unordered_set<flecs::entity_t> dirty {};
+
+        /**
+        @brief Mark every compiled tree containing @c node as dirty.
+        */
+        void invalidate(flecs::entity node)
         {
-			case TemporalConstructor::IND:      return "IND";
-			case TemporalConstructor::SEQ:      return "SEQ";
-			case TemporalConstructor::SEQ_ORD:  return "SEQ-ORD";
-			default: return "Undefined";
+            for (auto e = node; e.is_valid(); e = e.get_object(flecs::ChildOf))
+            {
+                if (e.has<CompiledTaskTree>())
+                    dirty.insert(e.id());
+            }
         }
+    };
+
+    /**
+    @brief Component holding an agent's progress in an activity tree and the leaves it can execute.
+    */
+    struct TaskProgress
+    {
+        /**
+        @brief Root entity, holding a @c CompiledTaskTree.
+        */
+        flecs::entity_t     root {0};
+
+        TaskTreeState       state {};
+        TaskTreeEvaluation  evaluation {};
+
+        /**
+        @brief Request a full evaluation during the next tick.
+        */
+        bool                dirty {true};
+
+        /**
+        @brief Version of the compiled tree @c state is indexed by, see @c CompiledTaskTree::version.
+        */
+        std::uint64_t       version {0};
+    };
+
+    /**
+    @brief Compile the activity tree under @c root and store it on @c root. It is then compiled again by @c module::ADL
+    whenever its nodes change.
+    */
+    inline void compile_tree(flecs::entity root)
+    {
+        auto previous = root.get<CompiledTaskTree>();
+        root.set<CompiledTaskTree>({ compile_task_tree(root), previous ? previous->version + 1 : 1 });
     }
 
-    inline bool is_cooperative(const flecs::entity& e)
+    /**
+    @brief Make @c agent progress in the activity tree under @c root, which must be compiled.
+    */
+    inline void follow(flecs::entity agent, flecs::entity root)
     {
-        return e.has<type::Arity>() && e.get<type::Arity>()->value > 1;
+        auto compiled = root.get<CompiledTaskTree>();
+        agent.set<TaskProgress>({ root.id(), compiled->tree.make_state(), {}, true, compiled->version });
     }
 
-    inline bool is_mastered(const flecs::entity& agent, const flecs::entity& action)
+    /**
+    @brief Mark @c node (a leaf of the agent's activity tree) as done, or only as started, and incrementally
+    update the agent's eligible leaves.
+    */
+    inline void task_progress(flecs::entity agent, flecs::entity node, bool done = true)
     {
-        return agent.has<type::Qualification>() && (agent.get<type::Qualification>()->value >= action.get<type::Qualification>()->value);
+        auto progress = agent.get_mut<TaskProgress>();
+        const auto& tree = flecs::entity(agent.world(), progress->root).get<CompiledTaskTree>()->tree;
+        const auto index = tree.find(node.id());
+        if (index == TaskTree::npos)
+            return;
+
+        if (done)
+            progress->state.done.set(index);
+        else
+            progress->state.started.set(index);
+
+        if (!progress->dirty) // Otherwise, a full evaluation is pending anyway.
+            tree.update(progress->state, progress->evaluation, index);
+    }
+
+    /**
+    @brief Call @c func with each leaf (action) @c agent can execute now. Reads the live world : not callable from flows in pipelined mode.
+    @tparam F Accept function with following signature : @c std::function<void(flecs::entity)>
+    */
+    template<typename F>
+    void for_each_eligible(const flecs::entity& agent, F&& func)
+    {
+        assert(!detail::world_progressing && "for_each_eligible() reads the live world, it cannot be called from flows in pipelined mode.");
+        auto progress = agent.get<TaskProgress>();
+        if (!progress || progress->dirty)
+            return;
+        auto world = agent.world();
+        const auto& tree = flecs::entity(world, progress->root).get<CompiledTaskTree>()->tree;
+        progress->evaluation.eligible.for_each([&](size_t index) { func(flecs::entity(world, tree.id(index))); });
+    }
+
+    /**
+    @brief Candidate choice of an action by an agent, submitted by its flows.
+    */
+    struct AllocationProposal
+    {
+        flecs::entity_t agent {0};
+        flecs::entity_t action {0};
+        float           score {1.f};
+    };
+
+    /**
+    @brief Singleton collecting proposals from all flows during a tick, solved once at the next tick.
+    Agents' assignments are written to their @c CurrentAction.
+    */
+    struct TaskAllocation
+    {
+        explicit TaskAllocation(size_t capacity = 4096) :
+            proposals{ std::make_shared<MpscQueue<AllocationProposal>>(capacity) }
+        {}
+
+        std::shared_ptr<MpscQueue<AllocationProposal>> proposals;
+
+        /**
+        @brief Proposals that did not fit in @c proposals, so that none is lost when many agents propose during a tick.
+        Slower since it is guarded by a mutex : increase the capacity if it is used at every tick (see @c overflowed).
+        */
+        std::shared_ptr<ThreadsafeQueue<AllocationProposal>> overflow { std::make_shared<ThreadsafeQueue<AllocationProposal>>() };
+
+        /**
+        @brief Number of proposals that went to @c overflow during the last solved tick.
+        */
+        size_t overflowed {0};
+
+        /**
+        @brief Kept between ticks to reuse its buffers.
+        */
+        std::shared_ptr<AllocationSolver> solver { std::make_shared<AllocationSolver>() };
+    };
+
+    /**
+    @brief Propose to assign @c action to @c agent. Thread-safe, meant to be called from flows instead of
+    acting directly : all proposals of a tick are solved together so that cooperative actions get exactly
+    their arity of agents. Returns false if @c action is null or if @c module::ADL is not imported.
+    */
+    inline bool propose(flecs::entity agent, flecs::entity action, float score = 1.f)
+    {
+        if (action.id() == 0)
+            return false;
+        auto allocation = agent.world().get<TaskAllocation>();
+        if (!allocation)
+            return false;
+        const AllocationProposal proposal{ agent.id(), action.id(), score };
+        if (!allocation->proposals->try_push(proposal))
+            allocation->overflow->push(proposal);
+        return true;
     }
 
     namespace module{
@@ -103,6 +439,260 @@ namespace dynamo{
             explicit ADL(flecs::world& world)
             {
                 world.module<ADL>();
+                world.import<module::BasicAction>();
+
+                world.set<FeasibilityMatrix>({});
+                world.set<TaskAllocation>(TaskAllocation{});
+
+                world.observer<>("ADL_OnActionChange")
+                    .term<type::Action>()
+                    .event(flecs::OnAdd)
+                    .event(flecs::OnRemove)
+                    .iter([](flecs::iter& it) { it.world().get_mut<FeasibilityMatrix>()->dirty = true; });
+                invalidate_on_change<type::Qualification>(world);
+                invalidate_on_change<type::Arity>(world);
+                invalidate_on_change<type::PreCondition_Contextual>(world);
+                invalidate_on_change<type::PreCondition_Nomological>(world);
+                invalidate_on_change<type::PreCondition_Reglemantary>(world);
+                invalidate_on_change<type::PreCondition_Favorable>(world);
+
+                // Nodes are ordered by creation, see NodeOrder. Trees are compiled again when a node is added, moved or
+                // removed, or when its constructors or preconditions change.
+                world.set<TaskTrees>({});
+                order_on_add<type::Task>(world);
+                order_on_add<type::Action>(world);
+                invalidate_trees_on_change<type::Task>(world, flecs::OnAdd);
+                invalidate_trees_on_change<type::Action>(world, flecs::OnAdd);
+                invalidate_trees_on_change<LogicalConstructor>(world, flecs::OnSet);
+                invalidate_trees_on_change<TemporalConstructor>(world, flecs::OnSet);
+                invalidate_trees_on_change<NodeOrder>(world, flecs::OnSet);
+                world.observer<>("ADL_OnTaskTreeMove")
+                    .term(flecs::ChildOf).obj(flecs::Wildcard)
+                    .event(flecs::OnAdd)
+                    .event(flecs::OnRemove)
+                    .iter([](flecs::iter& it) {
+                        auto trees = it.world().get_mut<TaskTrees>();
+                        for (auto i : it)
+                        {
+                            auto e = it.entity(i);
+                            if (e.has<type::Task>() || e.has<type::Action>())
+                                trees->invalidate(e);
+                        }
+                    });
+
+                world.observer<const type::Qualification>("ADL_OnQualificationChange")
+                    .term<type::Agent>()
+                    .event(flecs::OnSet)
+                    .each([](flecs::entity agent, const type::Qualification& _) {
+                        agent.get_mut<FeasibleActions>()->version = 0;
+                    });
+
+                // Followers of a compiled tree are re-evaluated during the next tick.
+                world.observer<const CompiledTaskTree>("ADL_OnTaskTreeChange")
+                    .event(flecs::OnSet)
+                    .each([](flecs::entity root, const CompiledTaskTree& _) {
+                        root.world().each([&root](flecs::entity agent, TaskProgress& progress) {
+                            if (progress.root == root.id())
+                                progress.dirty = true;
+                        });
+                    });
+
+                // Trees whose nodes changed are compiled again. Followers keep their progress on the nodes still in the tree.
+                world.system<>("ADL_CompileTaskTrees")
+                    .kind(flecs::PostUpdate)
+                    .iter([](flecs::iter& it) {
+                        auto world = it.world();
+                        auto trees = world.get_mut<TaskTrees>();
+                        if (trees->dirty.empty())
+                            return;
+                        const auto roots = std::move(trees->dirty);
+                        trees->dirty.clear();
+
+                        for (auto id : roots)
+                        {
+                            auto root = flecs::entity(world, id);
+                            if (!root.is_alive() || !root.has<CompiledTaskTree>())
+                                continue;
+                            auto tree = compile_task_tree(root);
+                            auto previous = root.get<CompiledTaskTree>();
+                            const auto version = previous->version + 1;
+                            world.each([&root, &tree, previous, version](flecs::entity agent, TaskProgress& progress) {
+                                if (progress.root != root.id() || progress.version != previous->version)
+                                    return;
+                                progress.state = tree.remap(progress.state, previous->tree);
+                                progress.version = version;
+                            });
+                            root.set<CompiledTaskTree>({ std::move(tree), version });
+                        }
+                    });
+
+                // Dirty followers are evaluated in one pass per tree, see TaskTree::evaluate(...).
+                world.system<TaskProgress>("ADL_EligibleTasks")
+                    .kind(flecs::PostUpdate)
+                    .iter([](flecs::iter& it, TaskProgress* progress) {
+                        std::unordered_map<flecs::entity_t, std::pair<std::vector<const TaskTreeState*>, std::vector<TaskTreeEvaluation*>>> batches{};
+                        for (auto i : it)
+                        {
+                            if (!progress[i].dirty)
+                                continue;
+                            auto tree = flecs::entity(it.world(), progress[i].root).get<CompiledTaskTree>();
+                            if (!tree || progress[i].version > tree->version)
+                                continue; // Remapped to a tree not stored yet.
+                            if (progress[i].version < tree->version || progress[i].state.done.size() != tree->tree.size())
+                            {
+                                // Compiled again without remapping (see compile_tree(...)) : progress is lost.
+                                progress[i].state = tree->tree.make_state();
+                                progress[i].version = tree->version;
+                            }
+                            auto& [states, evaluations] = batches[progress[i].root];
+                            states.push_back(&progress[i].state);
+                            evaluations.push_back(&progress[i].evaluation);
+                            progress[i].dirty = false;
+                        }
+                        for (const auto& [root, batch] : batches)
+                            flecs::entity(it.world(), root).get<CompiledTaskTree>()->tree.evaluate(batch.first, batch.second);
+                    });
+
+                // Proposals submitted by flows during the previous tick are solved at once and written back in bulk.
+                world.system<>("ADL_Allocation")
+                    .kind(flecs::PreUpdate)
+                    .iter([](flecs::iter& it) {
+                        auto world = it.world();
+                        auto allocation = world.get_mut<TaskAllocation>();
+                        auto& solver = *allocation->solver;
+                        solver.clear();
+                        auto submit = [&world, &solver](AllocationProposal&& proposal) {
+                            auto agent = flecs::entity(world, proposal.agent);
+                            auto action = flecs::entity(world, proposal.action);
+                            if (!agent.is_alive() || !action.is_alive())
+                                return;
+                            solver.propose(
+                                solver.agent(proposal.agent, agent.has<type::Qualification>() ? agent.get<type::Qualification>()->value : 0),
+                                solver.action(proposal.action,
+                                    action.has<type::Arity>() ? action.get<type::Arity>()->value : 1,
+                                    action.has<type::Qualification>() ? action.get<type::Qualification>()->value : 0),
+                                proposal.score);
+                        };
+                        allocation->proposals->drain(submit);
+                        allocation->overflowed = 0;
+                        while (auto proposal = allocation->overflow->pop())
+                        {
+                            submit(std::move(*proposal));
+                            allocation->overflowed++;
+                        }
+                        if (solver.agents() == 0)
+                            return;
+
+                        solver.solve();
+
+                        // Cooperative actions joined or left by an agent : their performers that did not propose
+                        // this tick are released, so that the action is never left with fewer (or more) than its arity.
+                        std::vector<flecs::entity_t> changed{};
+                        auto is_cooperative = [&world](flecs::entity_t action) {
+                            auto arity = flecs::entity(world, action).get<type::Arity>();
+                            return arity && arity->value > 1;
+                        };
+                        for (size_t i = 0; i < solver.agents(); i++)
+                        {
+                            auto agent = flecs::entity(world, solver.agent_id(i));
+                            const auto assignment = solver.assignment(i);
+                            const flecs::entity_t action = assignment == AllocationSolver::npos ? 0 : solver.action_id(assignment);
+                            const auto current = agent.get<CurrentAction>();
+                            const flecs::entity_t previous = current ? current->action : 0;
+                            if (previous == action)
+                                continue;
+                            if (previous != 0 && is_cooperative(previous))
+                                changed.push_back(previous);
+                            if (action != 0 && is_cooperative(action))
+                                changed.push_back(action);
+                            perform(agent, action);
+                        }
+
+                        std::vector<flecs::entity_t> released{};
+                        for (auto action : changed)
+                        {
+                            for (auto performer : performers(flecs::entity(world, action)))
+                            {
+                                if (!solver.contains(performer))
+                                    released.push_back(performer);
+                            }
+                        }
+                        for (auto performer : released)
+                            perform(flecs::entity(world, performer), 0);
+                    });
+
+                // Agents are only re-evaluated when the matrix or their qualification changed.
+                world.system<const type::Qualification>("ADL_Feasibility")
+                    .term<type::Agent>()
+                    .kind(flecs::PostUpdate)
+                    .each([](flecs::entity agent, const type::Qualification& qualification) {
+                        auto matrix = agent.world().get_mut<FeasibilityMatrix>();
+                        if (matrix->dirty)
+                        {
+                            auto world = agent.world();
+                            matrix->compile(world);
+                        }
+
+                        auto feasible = agent.get_mut<FeasibleActions>();
+                        if (feasible->version != matrix->version)
+                        {
+                            matrix->evaluate(qualification.value, feasible->bits);
+                            feasible->version = matrix->version;
+                        }
+                    });
+            }
+
+        private:
+            template<typename T>
+            static void invalidate_on_change(flecs::world& world)
+            {
+                world.observer<const T>()
+                    .term<type::Action>()
+                    .event(flecs::OnSet)
+                    .event(flecs::OnRemove)
+                    .iter([](flecs::iter& it, const T* _) {
+                        it.world().get_mut<FeasibilityMatrix>()->dirty = true;
+                        auto trees = it.world().get_mut<TaskTrees>();
+                        for (auto i : it)
+                            trees->invalidate(it.entity(i));
+                    });
+            }
+
+            /**
+            @brief Mark compiled trees containing an entity as dirty when its @c T is set (or added) with @c event, or removed.
+            */
+            template<typename T>
+            static void invalidate_trees_on_change(flecs::world& world, flecs::entity_t event)
+            {
+                world.observer<>()
+                    .term<T>()
+                    .event(event)
+                    .event(flecs::OnRemove)
+                    .iter([](flecs::iter& it) {
+                        auto trees = it.world().get_mut<TaskTrees>();
+                        for (auto i : it)
+                            trees->invalidate(it.entity(i));
+                    });
+            }
+
+            /**
+            @brief Give nodes tagged with @c T their creation order, see @c NodeOrder.
+            */
+            template<typename T>
+            static void order_on_add(flecs::world& world)
+            {
+                world.observer<>()
+                    .term<T>()
+                    .event(flecs::OnAdd)
+                    .iter([](flecs::iter& it) {
+                        auto trees = it.world().get_mut<TaskTrees>();
+                        for (auto i : it)
+                        {
+                            auto e = it.entity(i);
+                            if (!e.has<NodeOrder>())
+                                e.set<NodeOrder>({ trees->next_order++ });
+                        }
+                    });
             }
         };
     }
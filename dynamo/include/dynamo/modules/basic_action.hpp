@@ -1,23 +1,255 @@
 #pragma once
 
+#include <cassert>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
 #include <flecs.h>
 
+#include <dynamo/internal/types.hpp>
+
 namespace dynamo{
 
 	struct Cost{
 		int value {0};
 	};
 
+	/**
+	* Singleton holding, for each registered tag, the actions having this tag.
+	* Maintained by observers so that behaviours can list actions without scanning the world.
+	*/
+	struct ActionCatalog{
+		struct Entry{
+			std::vector<flecs::entity> actions {};
+			std::unordered_map<flecs::entity_t, size_t> index {};
+		};
+
+		std::unordered_map<flecs::entity_t, Entry> entries {};
+
+		/**
+		* Actions having @c tag. Empty if @c tag was not registered.
+		* The span is invalidated when an action with this tag is added or removed.
+		*/
+		std::span<const flecs::entity> actions(flecs::entity_t tag) const{
+			auto it = entries.find(tag);
+			if(it == entries.end())
+				return {};
+			return it->second.actions;
+		}
+
+		void insert(flecs::entity_t tag, flecs::entity action){
+			auto& entry = entries[tag];
+			if(entry.index.contains(action.id()))
+				return;
+			entry.index.emplace(action.id(), entry.actions.size());
+			entry.actions.push_back(action);
+		}
+
+		/**
+		* O(1) removal, the last action takes the place of the removed one.
+		*/
+		void erase(flecs::entity_t tag, flecs::entity action){
+			auto& entry = entries[tag];
+			auto it = entry.index.find(action.id());
+			if(it == entry.index.end())
+				return;
+			const size_t idx = it->second;
+			entry.index.erase(it);
+			if(idx != entry.actions.size() - 1){
+				entry.actions[idx] = entry.actions.back();
+				entry.index[entry.actions[idx].id()] = idx;
+			}
+			entry.actions.pop_back();
+		}
+	};
+
+	/**
+	* Register @c TTag in the @c ActionCatalog : actions having this tag will be listed by @c actions<TTag>(...).
+	* Existing actions are added right away, further ones as they are tagged.
+	*/
+	template<typename TTag>
+	void catalog(flecs::world& world){
+		const flecs::entity_t tag = world.id<TTag>();
+		// Added if missing, e.g when module::BasicAction is not imported.
+		auto catalog = world.get_mut<ActionCatalog>();
+		if(catalog->entries.contains(tag))
+			return;
+
+		catalog->entries[tag];
+		world.each<const TTag>([catalog, tag](flecs::entity e, const TTag _) {
+			if(e.has<type::Action>())
+				catalog->insert(tag, e);
+		});
+
+		world.observer<>()
+			.term<TTag>()
+			.term<type::Action>()
+			.event(flecs::OnAdd)
+			.iter([tag](flecs::iter& it) {
+				auto catalog = it.world().get_mut<ActionCatalog>();
+				for(auto i : it){
+					catalog->insert(tag, it.entity(i));
+				}
+			});
+
+		world.observer<>()
+			.term<TTag>()
+			.term<type::Action>()
+			.event(flecs::OnRemove)
+			.iter([tag](flecs::iter& it) {
+				auto catalog = it.world().get_mut<ActionCatalog>();
+				for(auto i : it){
+					catalog->erase(tag, it.entity(i));
+				}
+			});
+	}
+
+	/**
+	* Actions having @c TTag, without scanning nor allocating. @c TTag must be registered with @c catalog<TTag>(...).
+	* Reads the live world : not callable from flows in pipelined mode.
+	*/
+	template<typename TTag>
+	std::span<const flecs::entity> actions(flecs::world& world){
+		assert(!detail::world_progressing && "actions() reads the live world, it cannot be called from flows in pipelined mode.");
+		auto catalog = world.get<ActionCatalog>();
+		assert(catalog && "No action catalog. Register tags with catalog<TTag>(world) first.");
+		return catalog ? catalog->actions(world.id<TTag>()) : std::span<const flecs::entity>{};
+	}
+
+	/**
+	* Overload accepting a temporary world handle, e.g @c actions<TTag>(agent.entity().world()).
+	*/
+	template<typename TTag>
+	std::span<const flecs::entity> actions(flecs::world&& world){
+		return actions<TTag>(world);
+	}
+
+	/**
+	* Component holding the action an agent is currently performing, 0 if none.
+	* Switching actions is a field write : unlike a pair relation, it never moves the agent to another table.
+	* Switch with @c perform(...). Other writes (e.g through @c get_mut) must be followed by
+	* @c modified<CurrentAction>(), so that @c ActionPerformers is updated.
+	*/
+	struct CurrentAction{
+		flecs::entity_t action {0};
+
+		/**
+		* Simulation time (see @c Clock) at which the action started
+		*/
+		float start_time {0.f};
+
+		/**
+		* Progress of the action, from 0 to 1 by convention. Reset by @c perform(...) and advanced by
+		* whatever carries the action out (e.g a flow or a routine of the agent), never by the library.
+		*/
+		float progress {0.f};
+	};
+
+	/**
+	* Singleton indexing, for each action, the agents currently performing it.
+	* Maintained by observers on @c CurrentAction, so only switching agents are visited.
+	*/
+	struct ActionPerformers{
+		struct Slot{
+			flecs::entity_t action {0};
+			size_t index {0};
+		};
+
+		std::unordered_map<flecs::entity_t, std::vector<flecs::entity_t>> performers {};
+
+		/**
+		* Action of each indexed agent and its position in the list of performers.
+		*/
+		std::unordered_map<flecs::entity_t, Slot> slots {};
+
+		/**
+		* Agents performing @c action. The span is invalidated when an agent starts or stops performing it.
+		*/
+		std::span<const flecs::entity_t> of(flecs::entity_t action) const{
+			auto it = performers.find(action);
+			if(it == performers.end())
+				return {};
+			return it->second;
+		}
+
+		/**
+		* Index @c agent as performing @c action (0 for none), in O(1).
+		*/
+		void assign(flecs::entity_t agent, flecs::entity_t action){
+			auto it = slots.find(agent);
+			if(it != slots.end()){
+				if(it->second.action == action)
+					return;
+				erase(it->second);
+				slots.erase(it);
+			}
+			if(action == 0)
+				return;
+			auto& list = performers[action];
+			slots.emplace(agent, Slot{ action, list.size() });
+			list.push_back(agent);
+		}
+
+	private:
+		/**
+		* O(1) removal, the last performer takes the place of the removed one.
+		*/
+		void erase(const Slot& slot){
+			auto& list = performers[slot.action];
+			if(slot.index != list.size() - 1){
+				list[slot.index] = list.back();
+				slots[list[slot.index]].index = slot.index;
+			}
+			list.pop_back();
+		}
+	};
+
+	/**
+	* Make @c agent perform @c action from now on. Does nothing if it is already performing it.
+	*/
+	inline void perform(flecs::entity agent, flecs::entity_t action){
+		auto current = agent.get<CurrentAction>();
+		if(current && current->action == action)
+			return;
+		auto clock = agent.world().get<Clock>();
+		agent.set<CurrentAction>({ action, clock ? clock->time : 0.f, 0.f });
+	}
+
+	/**
+	* Agents currently performing @c action. Empty if @c module::BasicAction is not imported.
+	* Reads the live world : not callable from flows in pipelined mode.
+	*/
+	inline std::span<const flecs::entity_t> performers(flecs::entity action){
+		assert(!detail::world_progressing && "performers() reads the live world, it cannot be called from flows in pipelined mode.");
+		auto index = action.world().get<ActionPerformers>();
+		return index ? index->of(action.id()) : std::span<const flecs::entity_t>{};
+	}
+
     namespace module{
         /**
-         * Module adding perception functionalities.
+         * Module adding action functionalities.
          */
         struct BasicAction{
             /**
-             * Module adding perception functionalities.
+             * Module adding action functionalities.
              */
             explicit BasicAction(flecs::world& world){
                 world.module<BasicAction>();
+                world.set<ActionCatalog>({});
+                world.set<ActionPerformers>({});
+
+                world.observer<const CurrentAction>("OnSet_CurrentAction_Performers")
+                    .event(flecs::OnSet)
+                    .each([](flecs::entity agent, const CurrentAction& current) {
+                        agent.world().get_mut<ActionPerformers>()->assign(agent.id(), current.action);
+                    });
+
+                world.observer<const CurrentAction>("OnRemove_CurrentAction_Performers")
+                    .event(flecs::OnRemove)
+                    .each([](flecs::entity agent, const CurrentAction& _) {
+                        agent.world().get_mut<ActionPerformers>()->assign(agent.id(), 0);
+                    });
             }
         };
     }
@@ -1,7 +1,15 @@
 #pragma once
 
 #include <dynamo/internal/core.hpp>
+#include <dynamo/modules/messaging.hpp>
+#include <dynamo/utils/hash.hpp>
+#include <dynamo/utils/mpsc_queue.hpp>
+#include <algorithm>
+#include <functional>
+#include <memory>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace dynamo{
 
@@ -19,6 +27,11 @@ namespace dynamo{
 		* Period
 		*/
 		float cooldown;
+
+		/**
+		* If positive, repeated emissions within this window (in seconds) are aggregated into one percept
+		*/
+		float aggregation_window {0.f};
 	};
 
 	/**
@@ -26,11 +39,177 @@ namespace dynamo{
 	*/
 	struct Message{
 		/**
-		* Content of the message
+		* Content of the message, shared (not copied) between all percepts carrying it
+		*/
+		Payload  message {Payload::intern("Bonjour")};
+	};
+
+	/**
+	* Identifies identical stimuli : same source, sense and payload
+	*/
+	struct AggregationKey{
+		flecs::entity_t source {0};
+		flecs::id_t sense {0};
+		size_t payload {0};
+
+		bool operator==(const AggregationKey&) const = default;
+
+		struct Hash{
+			size_t operator()(const AggregationKey& key) const { return hash_of(key.source, key.sense, key.payload); }
+		};
+	};
+
+	/**
+	* Component counting how many identical stimuli an aggregated percept stands for
+	*/
+	struct Occurrences{
+		/**
+		* Number of stimuli aggregated
+		*/
+		size_t count {1};
+
+		/**
+		* @c Clock time of the last stimulus
+		*/
+		float last_seen {0.f};
+
+		/**
+		* Identifies this percept in @c AggregatedPercepts
 		*/
-		std::string  message {"Bonjour"};
+		AggregationKey key {};
+	};
+
+	/**
+	* Singleton indexing live aggregated percepts by (source, sense, payload)
+	*/
+	struct AggregatedPercepts{
+		std::unordered_map<AggregationKey, flecs::entity_t, AggregationKey::Hash> index {};
+	};
+
+	/**
+	* Emission decided by a @c PeriodicEmitter on a worker stage, turned into a percept on the main thread
+	*/
+	struct Emission{
+		flecs::entity_t emitter {0};
+		flecs::entity_t payload {0};
+		float aggregation_window {0.f};
 	};
 
+	/**
+	* Singleton collecting emissions from all worker stages during a tick
+	*/
+	struct PendingEmissions{
+		std::shared_ptr<MpscQueue<Emission>> queue { std::make_shared<MpscQueue<Emission>>(4096) };
+	};
+
+	/**
+	* Construct a percept coming from @c source, or reuse the live one with same (source, sense, payload)
+	* if it was last seen less than @c window seconds ago. In that case, its @c Occurrences are updated
+	* instead of spawning a new entity. Call @c decay(...) on the result to refresh its lifetime.
+	*/
+	template<typename TSense>
+	Percept aggregated_percept(flecs::world& world, flecs::entity source, float window, size_t payload = 0){
+		const flecs::id_t sense = world.id<TSense>();
+		const AggregationKey key {source.id(), sense, payload};
+		const float now = world.get<Clock>()->time;
+
+		auto& index = world.get_mut<AggregatedPercepts>()->index;
+		if(auto it = index.find(key); it != index.end()){
+			auto percept = flecs::entity(world, it->second);
+			if(percept.is_alive()){
+				auto occurrences = percept.get_mut<Occurrences>();
+				if(now - occurrences->last_seen <= window){
+					occurrences->count++;
+					occurrences->last_seen = now;
+					return Percept(percept);
+				}
+			}
+		}
+
+		auto percept = PerceptBuilder(world).source<TSense>(source);
+		percept.set<Occurrences>({1, now, key});
+		index[key] = percept.entity().id();
+		return percept;
+	}
+
+	/**
+	* Turn emissions queued by @c PeriodicEmitter into percepts. Must be called outside of a system, once the
+	* world has merged (a @c Simulation does it after each progress) : linking a percept reads and updates
+	* the closure of its perceivers, which deferred operations would not see.
+	*/
+	inline void flush_emissions(flecs::world& world){
+		world.get<PendingEmissions>()->queue->drain([&world](Emission&& emission) {
+			auto e = flecs::entity(world, emission.emitter);
+			auto targets = e.get<Targets>();
+			if(!targets)
+				return;
+			auto percept = emission.aggregation_window > 0.f
+					? aggregated_percept<Hearing>(world, e, emission.aggregation_window, emission.payload)
+					: PerceptBuilder(world).source<Hearing>(e);
+			percept.decay();
+			for(const flecs::entity_view& entity_view : targets->entities){
+				percept.perceived_by(entity_view);
+			}
+		});
+	}
+
+	/**
+	* Component bounding how many percepts an agent attends to per tick.
+	* Can be set on an agent or on its @c AgentArchetype.
+	*/
+	struct Attention{
+		/**
+		* Maximum number of percepts surfaced per tick
+		*/
+		size_t capacity {4};
+	};
+
+	/**
+	* Component holding the percepts surfaced to an agent's flows this tick, most salient first
+	*/
+	struct Attended{
+		/**
+		* At most @c Attention::capacity percepts
+		*/
+		std::vector<flecs::entity> percepts {};
+
+		/**
+		* Number of perceived percepts left out this tick
+		*/
+		size_t ignored {0};
+	};
+
+	/**
+	* Singleton holding a salience function per sense. Percepts of an unregistered sense have a salience of 1.
+	*/
+	struct Salience{
+		std::unordered_map<flecs::entity_t, std::function<float(flecs::entity)>> functions {};
+
+		/**
+		* Highest salience among the senses of @c percept
+		*/
+		float of(flecs::entity percept) const {
+			float value = 1.0f;
+			bool found = false;
+			for(const auto& [sense, func] : functions){
+				if(percept.has(sense)){
+					float s = func(percept);
+					value = found ? std::max(value, s) : s;
+					found = true;
+				}
+			}
+			return value;
+		}
+	};
+
+	/**
+	* Register the salience function used to rank percepts of sense @c TSense.
+	*/
+	template<typename TSense>
+	void salience(flecs::world& world, std::function<float(flecs::entity)> func){
+		world.get_mut<Salience>()->functions[world.id<TSense>()] = std::move(func);
+	}
+
     namespace module{
         /**
         * Module adding perception functionalities.
@@ -43,18 +222,65 @@ namespace dynamo{
                 world.module<GlobalPerception>();
                 world.import<module::Core>();
 
-                world.system<PeriodicEmitter, Targets>("PeriodicEmitter")
+                // Emitters are checked on worker stages. Percepts are created afterwards on the main thread, once
+                // the world has merged (see flush_emissions), since linking them reads perceivers' closure.
+                world.set<PendingEmissions>({});
+                world.system<const PeriodicEmitter>("PeriodicEmitter")
+                        .term<Targets>()
                         .term<Cooldown>().obj<PeriodicEmitter>().oper(flecs::Not)
                         .arg(1).obj(flecs::Wildcard) // <- PeriodicEmitter is actually a pair type with anything
-                        .iter([](flecs::iter& iter, PeriodicEmitter* periodic_emitter, Targets* targets) {
+                        .multi_threaded(true)
+                        .iter([](flecs::iter& iter, const PeriodicEmitter* periodic_emitter) {
+                            auto& queue = *iter.world().get<PendingEmissions>()->queue;
                             for(auto i : iter){
                                 auto e = iter.entity(i);
-                                auto world = e.world();
-                                auto percept = PerceptBuilder(world).source<Hearing>(e).decay();
-                                for(flecs::entity_view& entity_view : targets[i].entities){
-                                    percept.perceived_by(entity_view);
+                                if(queue.try_push({e.id(), iter.id(1).object().id(), periodic_emitter[i].aggregation_window})){
+                                    e.set<Cooldown, PeriodicEmitter>({periodic_emitter[i].cooldown});
+                                } // Otherwise, try again next tick.
+                            }
+                        });
+
+                world.set<AggregatedPercepts>({});
+                world.observer<const Occurrences>("OnRemove_Occurrences_UpdateIndex")
+                        .event(flecs::OnRemove)
+                        .each([](flecs::entity percept, const Occurrences& occurrences) {
+                            auto& index = percept.world().get_mut<AggregatedPercepts>()->index;
+                            if(auto it = index.find(occurrences.key); it != index.end() && it->second == percept.id())
+                                index.erase(it);
+                        });
+
+                world.set<Salience>({});
+
+                // Select the top-k percepts with a bounded min-heap, so work is O(n log k) per agent
+                // and flows never see more than Attention::capacity percepts.
+                world.system<const Attention>("Attention")
+                        .kind(flecs::PostUpdate)
+                        .each([](flecs::entity agent, const Attention& attention) {
+                            using Candidate = std::pair<float, flecs::entity_t>;
+                            auto by_salience = [](const Candidate& a, const Candidate& b) { return a.first > b.first; };
+
+                            auto salience = agent.world().get<Salience>();
+                            auto attended = agent.get_mut<Attended>();
+                            attended->percepts.clear();
+                            attended->ignored = 0;
+
+                            std::vector<Candidate> heap;
+                            heap.reserve(attention.capacity + 1);
+                            agent.each<perceive>([&](flecs::entity percept) {
+                                if(!percept.has<type::Percept>())
+                                    return;
+                                heap.emplace_back(salience->of(percept), percept.id());
+                                std::push_heap(heap.begin(), heap.end(), by_salience);
+                                if(heap.size() > attention.capacity){
+                                    std::pop_heap(heap.begin(), heap.end(), by_salience);
+                                    heap.pop_back();
+                                    attended->ignored++;
                                 }
-                                e.set<Cooldown, PeriodicEmitter>({periodic_emitter[i].cooldown});
+                            });
+
+                            std::sort_heap(heap.begin(), heap.end(), by_salience);
+                            for(const auto& [_, id] : heap){
+                                attended->percepts.emplace_back(agent.world(), id);
                             }
                         });
             }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <dynamo/internal/core.hpp>
+#include <dynamo/modules/dynamics.hpp>
 #include <string>
 
 namespace dynamo {
@@ -31,17 +32,10 @@ namespace dynamo {
             explicit BasicStress(flecs::world& world) {
                 world.module<BasicStress>();
                 world.import<module::Core>();
+                world.import<module::Dynamics>();
 
-                world.system<Stress>()
-                    .kind(flecs::PreUpdate)
-                    .each([](flecs::entity entity, Stress& stress)
-                        {
-                            if (stress.value > 0.f)
-                            {
-                                stress.value -= entity.delta_time();
-                            }
-                        }
-                );
+                // Stress decreases by 1 per second, down to 0.
+                integrate<Stress>(world, dynamics::Decay{ 1.f, 0.f }, "Stress_Decay");
             }
         };
     }
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+
+#include <dynamo/internal/core.hpp>
+
+namespace dynamo {
+
+    /**
+    @brief Parameters of the dynamics a state variable can follow, see @c integrate(...).
+    */
+    namespace dynamics {
+        /**
+        @brief Linear decrease of @c rate per second, down to @c floor.
+        */
+        struct Decay {
+            float rate  {1.f};
+            float floor {0.f};
+        };
+
+        /**
+        @brief Exponential relaxation toward @c target, @c rate being the inverse of the time constant (in seconds).
+        */
+        struct Relaxation {
+            float target {0.f};
+            float rate   {1.f};
+        };
+
+        /**
+        @brief Linear increase of @c rate per second (decrease if negative), clamped in [@c min, @c max].
+        */
+        struct Accumulation {
+            float rate {1.f};
+            float min  {0.f};
+            float max  {100.f};
+        };
+    }
+
+    /**
+    @brief Kernels applying dynamics to @c count contiguous components, through their float member @c Member.
+
+    Parameters only depend on the time step, so they are computed once per call and the loops are branch-free.
+    */
+    namespace kernel {
+        template<auto Member, typename T>
+        inline void integrate(T* data, size_t count, float dt, const dynamics::Decay& params)
+        {
+            const float step = params.rate * dt;
+            const float floor = params.floor;
+            for (size_t i = 0; i < count; i++)
+            {
+                float& value = data[i].*Member;
+                value = std::max(floor, value - step);
+            }
+        }
+
+        template<auto Member, typename T>
+        inline void integrate(T* data, size_t count, float dt, const dynamics::Relaxation& params)
+        {
+            const float factor = 1.f - std::exp(-params.rate * dt);
+            const float target = params.target;
+            for (size_t i = 0; i < count; i++)
+            {
+                float& value = data[i].*Member;
+                value += (target - value) * factor;
+            }
+        }
+
+        template<auto Member, typename T>
+        inline void integrate(T* data, size_t count, float dt, const dynamics::Accumulation& params)
+        {
+            const float step = params.rate * dt;
+            const float min = params.min;
+            const float max = params.max;
+            for (size_t i = 0; i < count; i++)
+            {
+                float& value = data[i].*Member;
+                value = std::clamp(value + step, min, max);
+            }
+        }
+    }
+
+    /**
+    @brief Make the float member @c Member of every component @c T follow the given dynamics, e.g :
+
+    @code{.cpp}
+    integrate<Stress>(world, dynamics::Decay{ 1.f, 0.f });
+    integrate<Mood, &Mood::arousal>(world, dynamics::Relaxation{ 0.5f, 0.1f });
+    @endcode
+
+    A job is registered (see @c dynamo::job), each call of its kernel handling a contiguous range of a table column.
+    Components inherited through @c IsA are shared, hence not integrated : only owned ones are.
+    Returns the index of the job, so it can be disabled.
+
+    @tparam T Component type.
+    @tparam Member Pointer to the float member of @c T to integrate, @c &T::value by default.
+    @tparam TDynamics One of the structs of @c dynamo::dynamics.
+    */
+    template<typename T, auto Member = &T::value, typename TDynamics>
+    size_t integrate(flecs::world& world, TDynamics params, const char* name = "", bool overlap_flows = false)
+    {
+        return job<T>(world, name, [params](float delta_time, size_t count, T* data)
+            {
+                kernel::integrate<Member>(data, count, delta_time, params);
+            },
+            overlap_flows
+        );
+    }
+
+    namespace module {
+        /**
+        @brief Module for state variables following simple dynamics, registered with @c integrate(...).
+        */
+        struct Dynamics {
+            /**
+            @brief Module for state variables following simple dynamics, registered with @c integrate(...).
+            */
+            explicit Dynamics(flecs::world& world) {
+                world.module<Dynamics>();
+                world.import<module::Core>();
+            }
+        };
+    }
+}
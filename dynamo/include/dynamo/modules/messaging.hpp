@@ -0,0 +1,223 @@
+#pragma once
+
+#include <array>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <dynamo/internal/core.hpp>
+#include <dynamo/utils/mpsc_queue.hpp>
+
+namespace dynamo{
+
+	/**
+	* Immutable, ref-counted message content. Copies share the same buffer, so a payload
+	* sent to many recipients is never copied nor reallocated.
+	*/
+	class Payload{
+	public:
+		Payload() = default;
+
+		/**
+		* Construct a new (not interned) payload.
+		*/
+		Payload(const char* content) : data{ std::make_shared<const std::string>(content) } {}
+
+		/**
+		* Construct a new (not interned) payload.
+		*/
+		Payload(std::string content) : data{ std::make_shared<const std::string>(std::move(content)) } {}
+
+		/**
+		* Returns the unique payload with this content. Interned payloads live until the end of the program,
+		* so use it for recurring messages, not for one-off contents.
+		*/
+		static Payload intern(std::string_view content);
+
+		/**
+		* Content of the payload
+		*/
+		inline std::string_view view() const { return data ? std::string_view{ *data } : std::string_view{}; }
+
+		/**
+		* Content of the payload as a null-terminated string
+		*/
+		inline const char* c_str() const { return data ? data->c_str() : ""; }
+
+		inline bool empty() const { return !data || data->empty(); }
+
+		friend bool operator==(const Payload& a, const Payload& b){
+			return a.data == b.data || a.view() == b.view();
+		}
+
+	private:
+		explicit Payload(std::shared_ptr<const std::string> data) : data{ std::move(data) } {}
+
+		std::shared_ptr<const std::string> data {};
+	};
+
+	inline Payload Payload::intern(std::string_view content){
+		struct Shard{
+			std::mutex mutex;
+			std::unordered_map<std::string_view, std::shared_ptr<const std::string>> contents;
+		};
+		static std::array<Shard, 16> shards{};
+
+		auto& shard = shards[std::hash<std::string_view>{}(content) % shards.size()];
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		auto it = shard.contents.find(content);
+		if(it == shard.contents.end()){
+			auto data = std::make_shared<const std::string>(content);
+			it = shard.contents.emplace(std::string_view{ *data }, data).first;
+		}
+		return Payload(it->second);
+	}
+
+	/**
+	* A message as stored in a mailbox
+	*/
+	struct Envelope{
+		/**
+		* Entity that sent the message
+		*/
+		flecs::entity_t sender {0};
+
+		/**
+		* Organisation the message was published to, 0 if sent directly
+		*/
+		flecs::entity_t topic {0};
+
+		Payload payload {};
+	};
+
+	using MailboxQueue = MpscQueue<Envelope>;
+
+	/**
+	* Component giving an entity a bounded lock-free mailbox. Any thread, notably flow tasks, can post to it
+	* without going through the commands queue. Only one thread at a time should read it.
+	*
+	* A mailbox is not copyable : set one on each entity, not on an archetype.
+	*/
+	struct Mailbox{
+		explicit Mailbox(size_t capacity = 256) : queue{ std::make_shared<MailboxQueue>(capacity) } {}
+		Mailbox(const Mailbox&) = delete;
+		Mailbox& operator=(const Mailbox&) = delete;
+		Mailbox(Mailbox&&) noexcept = default;
+		Mailbox& operator=(Mailbox&&) noexcept = default;
+
+		/**
+		* Post an envelope. Returns false if the mailbox is full.
+		*/
+		inline bool post(Envelope envelope) const { return queue->try_push(std::move(envelope)); }
+
+		/**
+		* Pass every pending envelope to @c func, oldest first. Returns the number of envelopes read.
+		* @tparam F Accept function with following signature : @c std::function<void(Envelope&&)>
+		*/
+		template<typename F>
+		size_t receive(F&& func) const { return queue->drain(std::forward<F>(func)); }
+
+		std::shared_ptr<MailboxQueue> queue;
+	};
+
+	/**
+	* Singleton holding topic subscriptions : every mailbox of entities belonging to an organisation.
+	* Rebuilt on the main thread when memberships change, read-only while flows are running.
+	*/
+	struct MessageBus{
+		std::unordered_map<flecs::entity_t, std::vector<std::shared_ptr<MailboxQueue>>> subscribers {};
+		bool dirty {true};
+
+		/**
+		* Post @c envelope to every subscriber of @c topic. Returns the number of mailboxes reached.
+		*/
+		size_t publish(flecs::entity_t topic, const Envelope& envelope) const{
+			auto it = subscribers.find(topic);
+			if(it == subscribers.end())
+				return 0;
+			size_t delivered = 0;
+			for(const auto& queue : it->second){
+				delivered += queue->try_push(envelope);
+			}
+			return delivered;
+		}
+	};
+
+	/**
+	* Send @c payload from @c sender to @c recipient. Thread-safe, returns false if @c recipient has no mailbox or if it is full.
+	*/
+	inline bool send(flecs::entity sender, flecs::entity recipient, Payload payload){
+		auto mailbox = recipient.get<Mailbox>();
+		return mailbox && mailbox->post({ sender.id(), 0, std::move(payload) });
+	}
+
+	/**
+	* Publish @c payload from @c sender to every entity belonging to @c organisation. Thread-safe,
+	* returns the number of mailboxes reached.
+	*/
+	inline size_t publish(flecs::entity sender, flecs::entity organisation, Payload payload){
+		auto bus = sender.world().get<MessageBus>();
+		return bus ? bus->publish(organisation.id(), { sender.id(), organisation.id(), std::move(payload) }) : 0;
+	}
+
+	/**
+	* Pass every pending envelope of @c e to @c func. Returns the number of envelopes read.
+	* @tparam F Accept function with following signature : @c std::function<void(Envelope&&)>
+	*/
+	template<typename F>
+	size_t receive(flecs::entity e, F&& func){
+		auto mailbox = e.get<Mailbox>();
+		return mailbox ? mailbox->receive(std::forward<F>(func)) : 0;
+	}
+
+    namespace module{
+        /**
+        * Module adding messaging functionalities : mailboxes and topics keyed by organisations.
+        */
+        struct Messaging{
+            /**
+            * Module adding messaging functionalities : mailboxes and topics keyed by organisations.
+            */
+            explicit Messaging(flecs::world& world){
+                world.module<Messaging>();
+                world.import<module::Core>();
+
+                world.set<MessageBus>({});
+
+                world.observer<>("OnMembershipChange_MessageBus")
+                        .term<belongs_to>().obj(flecs::Wildcard)
+                        .event(flecs::OnAdd)
+                        .event(flecs::OnRemove)
+                        .iter([](flecs::iter& iter) {
+                            iter.world().get_mut<MessageBus>()->dirty = true;
+                        });
+
+                world.observer<const Mailbox>("OnMailboxChange_MessageBus")
+                        .event(flecs::OnAdd)
+                        .event(flecs::OnRemove)
+                        .iter([](flecs::iter& iter, const Mailbox* _) {
+                            iter.world().get_mut<MessageBus>()->dirty = true;
+                        });
+
+                // Subscriptions are rebuilt before flows run, so publishing never mutates the bus.
+                world.system<>("MessageBus_Subscriptions")
+                        .kind(flecs::PostFrame)
+                        .iter([](flecs::iter& iter) {
+                            auto bus = iter.world().get_mut<MessageBus>();
+                            if(!bus->dirty)
+                                return;
+                            bus->subscribers.clear();
+                            iter.world().each([bus](flecs::entity e, const Mailbox& mailbox) {
+                                e.each<belongs_to>([bus, &mailbox](flecs::entity organisation) {
+                                    bus->subscribers[organisation.id()].push_back(mailbox.queue);
+                                });
+                            });
+                            bus->dirty = false;
+                        });
+            }
+        };
+    }
+}
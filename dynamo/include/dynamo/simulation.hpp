@@ -1,6 +1,18 @@
 #ifndef DYNAMO_SIMULATION_HPP
 #define DYNAMO_SIMULATION_HPP
 
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <typeindex>
+#include <unordered_map>
+#include <unordered_set>
+
 #include <spdlog/fmt/bundled/format.h>
 
 #include <dynamo/utils/containers.hpp>
@@ -8,6 +20,9 @@
 #include <dynamo/internal/core.hpp>
 #include <dynamo/modules/basic_perception.hpp>
 #include <dynamo/modules/basic_action.hpp>
+#include <dynamo/internal/profiler.hpp>
+#include <dynamo/internal/static_flow.hpp>
+#include <dynamo/internal/watchdog.hpp>
 
 /**
 @file dynamo/Simulation.hpp
@@ -15,6 +30,56 @@
 */
 namespace dynamo {
 
+    /**
+    @brief How @c Simulation::step(...) schedules world progress and reasoning.
+    */
+    enum class StepMode
+    {
+        /**
+        @brief Progress the world, run flows and wait for them, then apply their commands.
+        Commands of flows launched at step @c t are visible at step @c t+1.
+        */
+        Sequential,
+
+        /**
+        @brief Flows launched at step @c t run while the world progresses at step @c t+1. Their commands are applied
+        at the end of step @c t+1, while flows of step @c t+1 are running, and are visible at step @c t+2 :
+        reasoning lags one tick behind the world.
+
+        Since the world is modified while flows are running, flows must only read flow-readable components
+        (see @c dynamo::snapshot<T>(...)) and must only write through commands (e.g @c AgentHandle).
+        */
+        Pipelined
+    };
+
+    /**
+    @brief Wall-clock durations of each phase of the last step, in milliseconds.
+    */
+    struct StepTimings
+    {
+        std::chrono::duration<double, std::milli> progress {0};
+        std::chrono::duration<double, std::milli> jobs {0};
+
+        /**
+        @brief Time spent waiting for flows. In pipelined mode, the part of reasoning that did not overlap.
+        */
+        std::chrono::duration<double, std::milli> flows {0};
+        std::chrono::duration<double, std::milli> commands {0};
+        std::chrono::duration<double, std::milli> total {0};
+    };
+
+    /**
+    @brief Time flows of one priority class spent queued, from being due to being launched.
+    */
+    struct QueueingDelay
+    {
+        size_t count {0};
+        std::chrono::duration<double, std::milli> total {0};
+        std::chrono::duration<double, std::milli> max {0};
+
+        inline std::chrono::duration<double, std::milli> mean() const { return count ? total / static_cast<double>(count) : total; }
+    };
+
     /**
     @class Simulation
 
@@ -30,23 +95,155 @@ namespace dynamo {
         Simulation();
 
         /**
-        @brief Construct an empty simulation. Also set the number of threads (default: std::thread::hardware_concurrency).
+        @brief Construct an empty simulation. Also set the number of threads (default: std::thread::hardware_concurrency - 1).
+        They are split between the executor running flows and jobs (see @c dynamo::job), and flecs worker stages running
+        multi-threaded systems (a quarter of them, from 8 threads on), so both pools never exceed @c number_of_threads.
         */
         Simulation(size_t number_of_threads);
 
+        /**
+        @brief Calls @c shutdown(), so no flow still runs while members are destroyed.
+        */
+        ~Simulation();
+
         /**
         @brief Destroy the simulation. Ensure all threads are finished.
         */
         void shutdown();
 
         //TODO add constraint
+        /**
+        @brief Index of the flows of one type, shared by the observers registered for this type.
+        */
+        struct FlowRegistry
+        {
+            /**
+            @brief Triggered flow of each agent.
+            */
+            std::unordered_map<flecs::entity_t, flecs::entity_t> flows {};
+
+            /**
+            @brief If @c true, triggered flows are launched at every step.
+            */
+            bool always {false};
+
+            /**
+            @brief Deadline of flows of this type, unless their @c AddFlow<T> sets one.
+            */
+            Deadline deadline {};
+
+            /**
+            @brief Priority of flows of this type, see @c Priority.
+            */
+            int priority {0};
+        };
+
+        /**
+        @class FlowTriggers
+
+        @brief Declare events launching the triggered flows (i.e added with @c is_cyclic set to @c false) of type @c T.
+
+        Events are matched by observers and batched : a flow triggered several times during a step is launched once,
+        right after the world progressed. Agents whose flows are not triggered cost nothing.
+
+        Usage :
+        @code{.cpp}
+        sim.flow<MyFlow>()
+            .on_percept<Hearing>()
+            .on_set<Stress>();
+        // ...
+        sim.signal<MyFlow>(agent);
+        @endcode
+        */
+        template<typename T>
+        class FlowTriggers
+        {
+        public:
+            FlowTriggers(Simulation& sim, std::shared_ptr<FlowRegistry> registry) : sim{ sim }, registry{ std::move(registry) } {}
+
+            /**
+            @brief Launch the flow when its agent perceives a percept of sense @c TSense.
+            */
+            template<typename TSense>
+            FlowTriggers& on_percept()
+            {
+                sim._world.observer<>(fmt::format("Trigger_{}_OnPercept_{}", typeid(T).name(), typeid(TSense).name()).c_str())
+                    .term<perceive>().obj(flecs::Wildcard)
+                    .event(flecs::OnAdd)
+                    .iter([&sim = sim, registry = registry](flecs::iter& it)
+                        {
+                            auto percept = it.id(1).object();
+                            if (!percept.has<TSense>())
+                                return;
+                            for (auto i : it)
+                                sim.trigger(*registry, it.entity(i));
+                        }
+                );
+                return *this;
+            }
+
+            /**
+            @brief Launch the flow when component @c TComponent of its agent is set.
+            */
+            template<typename TComponent>
+            FlowTriggers& on_set()
+            {
+                sim._world.observer<const TComponent>(fmt::format("Trigger_{}_OnSet_{}", typeid(T).name(), typeid(TComponent).name()).c_str())
+                    .event(flecs::OnSet)
+                    .iter([&sim = sim, registry = registry](flecs::iter& it, const TComponent* _)
+                        {
+                            for (auto i : it)
+                                sim.trigger(*registry, it.entity(i));
+                        }
+                );
+                return *this;
+            }
+
+            /**
+            @brief Launch the flow at every step, as soon as its previous run is done.
+            */
+            FlowTriggers& always()
+            {
+                registry->always = true;
+                return *this;
+            }
+
+            /**
+            @brief Cancel runs of flows of this type (cyclic ones included) taking longer than @c value. Applies to flows added afterwards.
+            @param back_off Factor applied to the period of a cyclic flow each time it overruns, up to @c max_period seconds.
+            */
+            FlowTriggers& deadline(std::chrono::duration<double, std::milli> value, float back_off = 1.f, float max_period = 60.f)
+            {
+                registry->deadline = { value, back_off, max_period };
+                return *this;
+            }
+
+            /**
+            @brief Launch due flows of this type before those of lower priority (see @c Priority). Applies to flows added afterwards.
+            */
+            FlowTriggers& priority(int value)
+            {
+                registry->priority = value;
+                return *this;
+            }
+
+        private:
+            Simulation& sim;
+            std::shared_ptr<FlowRegistry> registry;
+        };
+
         /**
         @brief Register a flow builder so that it can be instantiaed for each relevant agent and executed when required.
         @tparam Must be a callable of type std::function<void(Agent)>. /!\ Not enforced ! /!\
+
+        Flows added with @c is_cyclic set to @c false are only launched by the events declared on the returned @c FlowTriggers.
         */
         template<typename T>
-        void flow()
+        FlowTriggers<T> flow()
         {
+            auto registry = std::make_shared<FlowRegistry>();
+            flow_registries[typeid(T)] = registry;
+
             /**
             When an @c AddFlow<T> is added and if the parent is not a prefab (to circumvent copying),
             then create a child entity containing @c Process with T
@@ -58,7 +255,7 @@ namespace dynamo {
             */
             _world.observer<const AddFlow<T>>(fmt::format("AddFlow_{}", typeid(T).name()).c_str())
                 .event(flecs::OnAdd)
-                .iter([this](flecs::iter& it, const AddFlow<T>* details)
+                .iter([this, registry](flecs::iter& it, const AddFlow<T>* details)
                     {
                         for (auto i : it)
                         {
@@ -68,23 +265,69 @@ namespace dynamo {
 
                             auto flow = T(&strategies, AgentHandle(agent_entity));
                             flow.build();
+                            flow.fuse();
 
+                            // Process details keep the logical graph, the executed one is moved into the flow.
                             auto flow_entity = it.world().entity()
                                 .set_name(flow.name())
-                                //  .set<ProcessDetails>({ flow.process_details() }); // TODO Isn't this a problem with the move below ?
-                                .set<Flow>({ std::move(flow) })
+                                .child_of(agent_entity)
+                                .set<type::ProcessDetails>(flow.process_details())
+                                .set<Flow>({ std::make_unique<tf::Taskflow>(std::move(flow)) })
                                 .add<Counter>()
                                 .add<Duration>();
 
+                            // Flows of a type share a profile, unless their graph differs from the first one.
+                            auto& taskflow = *flow_entity.get<Flow>()->taskflow;
+                            auto& profile = flow_profiles[typeid(T)];
+                            if (!profile)
+                                profile = std::make_shared<FlowProfile>(taskflow);
+                            if (profile->size() == taskflow.num_tasks())
+                            {
+                                profiler->track(*profile, taskflow);
+                                flow_entity.set<Profile>({ profile });
+                            }
+
                             auto params = details[i];
+                            Deadline deadline = registry->deadline;
+                            if (params.deadline > 0.f)
+                                deadline.value = std::chrono::duration<double, std::milli>(params.deadline);
+                            if (deadline.value.count() > 0)
+                                flow_entity.set<Deadline>(deadline);
+                            if (registry->priority != 0)
+                                flow_entity.set<Priority>({ registry->priority });
+
                             if (params.is_cyclic)
+                            {
                                 flow_entity.set<Cyclic>({ params.period });
+                            }
+                            else
+                            {
+                                // Status is added now, so that launching the flow never moves it to another table.
+                                flow_entity.add<Trigger>().add<Status>();
+                                registry->flows[agent_entity.id()] = flow_entity.id();
+                            }
 
 							agent_entity.remove<AddFlow<T>>();
                         }
                     }
             );
 
+            // Dead flows (or flows of dead agents) are no longer triggered.
+            _world.observer<>()
+                .term<Trigger>()
+                .event(flecs::OnRemove)
+                .iter([registry](flecs::iter& it)
+                    {
+                        for (auto i : it)
+                        {
+                            auto flow_entity = it.entity(i);
+                            auto agent_entity = flow_entity.get_object(flecs::ChildOf);
+                            if (auto found = registry->flows.find(agent_entity.id()); found != registry->flows.end() && found->second == flow_entity.id())
+                                registry->flows.erase(found);
+                        }
+                    }
+            );
+
             _world.system<Flow, const Cyclic>()
                 .term<Status>().oper(flecs::Not)
                 .term<Cooldown>().oper(flecs::Not)
@@ -124,11 +367,22 @@ namespace dynamo {
                 .event(flecs::OnRemove)
                 .each([this](flecs::entity e, const Status& process)
                     {
-                        e.get_mut<Duration>()->value += std::chrono::system_clock::now() - e.get<Timestamp>()->value;
+                        if (auto timestamp = e.get<Timestamp>())
+                            e.get_mut<Duration>()->value += std::chrono::system_clock::now() - timestamp->value;
                     }
             );
         };
 
+        /**
+        @brief Launch the triggered flow of type @c T of @c agent during the next step.
+        */
+        template<typename T>
+        void signal(flecs::entity agent)
+        {
+            if (auto it = flow_registries.find(typeid(T)); it != flow_registries.end())
+                trigger(*it->second, agent);
+        }
+
         /**
         @brief Iterate over all agents for_each.
 
@@ -212,12 +466,97 @@ namespace dynamo {
             return  PerceptBuilder(_world).source<TSense>(source);
         };
 
+        /**
+        @brief Construct a percept coming from the specified source, aggregated with the live one
+        sharing the same source, sense and payload if it was last seen less than @c window seconds ago.
+        @param source        From which entity this percept comes from ?
+        @param window        Aggregation window in seconds.
+        @param payload       Hash identifying the content of the percept.
+        @tparam TSense       Which sense is responsible for perceiving this percept ?
+        */
+        template<typename TSense>
+        Percept aggregated_percept(flecs::entity source, float window, size_t payload = 0)
+        {
+            return dynamo::aggregated_percept<TSense>(_world, source, window, payload);
+        };
+
         /**
         @brief Advance simulation by one-step and specify elapsed time. Return false, if application should quit.
+
+        Systems are run first, then jobs that cannot overlap flows, then flows along with the other jobs.
         @param elapsed_time time elapsed. If 0 (default), then it is automatically measured;
         */
         bool step(float elapsed_time = 0.0f);
 
+        /**
+        @brief Set how steps are scheduled (default: @c StepMode::Sequential). When leaving pipelined mode,
+        waits for running flows and applies their commands.
+        */
+        void step_mode(StepMode value);
+
+        /**
+        @brief Returns how steps are scheduled.
+        */
+        inline StepMode step_mode() const { return mode; }
+
+        /**
+        @brief Returns per-phase timings of the last step.
+        */
+        inline const StepTimings& timings() const { return step_timings; }
+
+        /**
+        @brief Limit the wall-clock time spent reasoning each tick (default: 0, no limit).
+
+        Flows are then launched by the simulation as workers become free. Those not started once the budget is spent
+        are deferred to the next tick, where they gain priority (see @c priority_aging(...)). Flows still running are awaited,
+        but their anytime processes give up (see @c Process<T>::anytime()).
+        */
+        inline void reasoning_budget(std::chrono::duration<double, std::milli> value) { budget = value; }
+
+        inline std::chrono::duration<double, std::milli> reasoning_budget() const { return budget; }
+
+        /**
+        @brief Returns the number of flows deferred to the next tick because the reasoning budget was spent.
+        */
+        inline size_t deferred_flows() const { return queued_flows.size(); }
+
+        /**
+        @brief Due flows are launched by decreasing priority (see @c Priority), oldest first within a priority.
+        A deferred flow gains one priority level every @c ticks ticks, so that low priority flows are not starved (0 : no aging).
+        */
+        inline void priority_aging(size_t ticks) { aging = ticks; }
+
+        /**
+        @brief Returns, for each priority, the time flows spent queued since the simulation started.
+        */
+        inline const std::map<int, QueueingDelay, std::greater<int>>& queueing_delays() const { return queueing_stats; }
+
+        /**
+        @brief If @c true, durations of tasks are measured (moving averages per flow type and task), and due flows
+        of the same priority are launched by decreasing critical path (longest expected flow first), which shortens
+        the makespan of reasoning when flows have uneven costs.
+        */
+        inline void critical_path_scheduling(bool value)
+        {
+            critical_path_first = value;
+            profiler->enable(value);
+        }
+
+        /**
+        @brief Returns the critical path of flows of type @c T, from measured durations (0 if unknown).
+        */
+        template<typename T>
+        std::chrono::duration<double, std::milli> critical_path() const
+        {
+            auto it = flow_profiles.find(typeid(T));
+            return std::chrono::duration<double, std::milli>(it == flow_profiles.end() ? 0. : it->second->critical_path());
+        }
+
+        /**
+        @brief Returns every flow cancelled so far for overrunning its deadline (see @c Deadline), oldest first.
+        */
+        inline const std::vector<FlowOverrun>& overruns() const { return flow_overruns; }
+
         /**
         @brief Advance simulation by @c n step and specify elapsed time between each step.
         @param n number of steps
@@ -248,6 +587,114 @@ namespace dynamo {
         }
 
     private:
+        /**
+        @brief Split jobs whose @c overlap_flows is @c overlapping into chunks, and run them on the executor.
+        */
+        tf::Future<void> run_jobs(tf::Taskflow& taskflow, float delta_time, bool overlapping);
+
+        /**
+        @brief Apply the @c count oldest commands of the queue.
+        */
+        void apply_commands(size_t count);
+
+        /**
+        @brief Mark the flow of @c agent in @c registry, if any, to be launched during the next step.
+        */
+        void trigger(const FlowRegistry& registry, flecs::entity agent);
+
+        /**
+        @brief Launch every triggered flow that is not already running.
+        */
+        void launch_triggered_flows();
+
+        /**
+        @brief Start a new routine tick of @c delta_time seconds, and resume on the executor every routine whose awaited event fired.
+        */
+        void resume_routines(float delta_time);
+
+        /**
+        @brief Set the deadline of this tick's reasoning, renew the cancellation token of anytime processes and forget
+        critical paths computed during the previous tick.
+        */
+        void begin_reasoning();
+
+        /**
+        @brief Pipelined mode : keep the budget left at the end of a step, so that the next step resumes the clock
+        from there (see @c resume_reasoning()), instead of counting the time spent between steps and in @c world.progress(...).
+        */
+        void pause_reasoning();
+        void resume_reasoning();
+
+        /**
+        @brief Queue @c flow in the lane of its priority, to be launched by @c dispatch_flows(...).
+        */
+        void queue_flow(flecs::entity flow);
+
+        /**
+        @brief Launch queued flows by priority, while the budget lasts.
+
+        In sequential mode or with a budget, at most two flows per worker are in flight, so that queued flows are
+        launched in priority order as workers become free. If @c wait is @c true, waits for workers to be free and,
+        once the budget is spent, cancels anytime processes. Otherwise, every queued flow is launched right away.
+        */
+        void dispatch_flows(bool wait);
+
+        /**
+        @brief A due flow, waiting to be launched since tick @c tick.
+        */
+        struct QueuedFlow
+        {
+            flecs::entity_t flow;
+            int             priority;
+            std::int64_t    tick;
+            std::chrono::steady_clock::time_point since;
+
+            /**
+            @brief Critical path of the flow when queued, if measured.
+            */
+            double          rank;
+        };
+
+        /**
+        @brief Pop the queued flow with the highest priority, once aged.
+        */
+        QueuedFlow next_flow();
+
+        /**
+        @brief Watch @c flow, just launched, if it has a @c Deadline.
+        */
+        void watch(flecs::entity flow);
+
+        /**
+        @brief Earliest expiry of the watched flows, @c time_point::max() if none.
+        */
+        std::chrono::steady_clock::time_point next_expiry() const;
+
+        /**
+        @brief Expire watched flows whose deadline passed by @c now, see @c expire(...). Called while @c dispatch_flows(...) waits.
+        */
+        void expire_flows(std::chrono::steady_clock::time_point now);
+
+        /**
+        @brief Cancel and record @c flow, past its deadline since @c expiry, unless it is done. Its period backs off
+        once the executor is done (see @c back_off_flows()).
+        */
+        void expire(flecs::entity flow, std::chrono::steady_clock::time_point expiry);
+
+        /**
+        @brief Wait for watched flows until their deadline, and expire those still running. Then tell which expired flows are stalled.
+
+        Cancellation is cooperative : the running task of a cancelled flow still runs to completion, but the next ones are skipped.
+        A task that does not return keeps the step waiting : it is reported with @c FlowOverrun::stalled, but not interrupted.
+        */
+        void watch_flows();
+
+        /**
+        @brief Pause cyclic flows cancelled by @c watch_flows() for their new period. Must be called once they are done,
+        since it changes their table.
+        */
+        void back_off_flows();
+
         void pop_commands_queue();
         void flush_commands_queue();
         void flush_for_commands_queue();
@@ -261,35 +708,100 @@ namespace dynamo {
         tf::Executor    executor;
 
         /**
-        @brief ECS Database.
+        @brief Taskflows holding this tick's job chunks, kept alive until they are done.
+        */
+        tf::Taskflow    jobs_taskflow{};
+        tf::Taskflow    overlapping_jobs_taskflow{};
 
-        For more information, see https://flecs.docsforge.com/master/quickstart/#world.
+        /**
+        @brief Defer modification to entities to a command queue called after the end of frame.
         */
-        flecs::world    _world{};
+        CommandsQueue commands_queue{};
 
         /**
-        @brief Query to iterate over all agents
+        @brief Triggered flows to launch during the next step.
+        */
+        std::unordered_set<flecs::entity_t> triggered_flows{};
+        std::unordered_map<std::type_index, std::shared_ptr<FlowRegistry>> flow_registries{};
 
-        For more information, see https://flecs.docsforge.com/master/quickstart/#query .
+        StepMode        mode{ StepMode::Sequential };
+        StepTimings     step_timings{};
+
+        /**
+        @brief Reasoning budget, see @c reasoning_budget(...).
         */
-        flecs::query<const type::Agent> agents_query;
+        std::chrono::duration<double, std::milli> budget{ 0 };
+        std::chrono::steady_clock::time_point reasoning_deadline{};
+        std::chrono::steady_clock::duration reasoning_left{};
 
         /**
-        @brief Query to iterate over all taskflows that need to be launched 
+        @brief Flows waiting to be launched, in a lane per priority (oldest first), and the set of them to avoid queuing a flow twice.
+        */
+        std::map<int, std::deque<QueuedFlow>, std::greater<int>> flow_lanes{};
+        std::unordered_set<flecs::entity_t> queued_flows{};
+        size_t aging{ 8 };
+        std::map<int, QueueingDelay, std::greater<int>> queueing_stats{};
 
-        For more information, see https://flecs.docsforge.com/master/quickstart/#query .
+        /**
+        @brief Measures of tasks' durations, see @c critical_path_scheduling(...).
         */
-        flecs::query<Flow, Status, const Cyclic, const Launch> flows;
+        bool critical_path_first{ false };
+        std::shared_ptr<TaskProfiler> profiler{};
+        std::unordered_map<std::type_index, std::shared_ptr<FlowProfile>> flow_profiles{};
+        std::unordered_map<const FlowProfile*, double> critical_paths{};
 
         /**
-        @brief Defer modification to entities to a command queue called after the end of frame.
+        @brief Taskflows of flows removed while they may still be running, destroyed once the executor is done.
         */
-        CommandsQueue commands_queue{};
+        std::vector<std::unique_ptr<tf::Taskflow>> retired_flows{};
+
+        /**
+        @brief Flows launched by @c dispatch_flows(...) and not finished yet.
+        */
+        size_t                  flows_in_flight{ 0 };
+        std::mutex              dispatch_mutex{};
+        std::condition_variable dispatch_cv{};
+
+        /**
+        @brief Flows launched with a deadline, and when it expires.
+        */
+        std::vector<std::pair<flecs::entity_t, std::chrono::steady_clock::time_point>> watched_flows{};
+
+        /**
+        @brief Flows expired during this step, when they are considered stalled, and their entry in @c flow_overruns.
+        */
+        std::vector<std::tuple<flecs::entity_t, std::chrono::steady_clock::time_point, size_t>> expired_flows{};
+        std::vector<FlowOverrun> flow_overruns{};
+        std::vector<flecs::entity_t> backed_off_flows{};
+        std::shared_ptr<RunningTasks> running_tasks{};
 
         /**
         @brief Associative container to store strategies by their types. So only one strategy of a same type can be defined.
         */
         Strategies strategies;
+
+        /**
+        @brief ECS Database.
+
+        Declared last, so it is destroyed first : its observers (e.g retiring flows) still reach the other members.
+
+        For more information, see https://flecs.docsforge.com/master/quickstart/#world.
+        */
+        flecs::world    _world{};
+
+        /**
+        @brief Query to iterate over all agents
+
+        For more information, see https://flecs.docsforge.com/master/quickstart/#query .
+        */
+        flecs::query<const type::Agent> agents_query;
+
+        /**
+        @brief Manual system launching all taskflows that need to be launched
+
+        For more information, see https://flecs.docsforge.com/master/manual/#systems .
+        */
+        flecs::system<Flow, Status, const Cyclic, const Launch> flows;
     };
 
     /**
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <span>
 #include <unordered_set>
 
 #include <dynamo/internal/flow.hpp>
@@ -42,6 +43,28 @@ namespace dynamo::strat{
         }
     };
 
+    /**
+    @brief Like @c ContainerAccumulator, but behaviours return a view on their elements (e.g @c actions<TTag>(...)),
+    which are copied once into the output.
+    */
+    template<typename TOutput>
+    class SpanAccumulator : public Strategy<TOutput, std::span<const typename TOutput::value_type>>
+    {
+        using Behaviour_t = Behaviour<std::span<const typename TOutput::value_type>>;
+    public:
+
+        TOutput compute(AgentHandle agent, const std::vector<Behaviour_t const*> active_behaviours) const override
+        {
+            TOutput results{};
+            for (auto behaviour : active_behaviours)
+            {
+                auto view = (*behaviour)(agent);
+                results.insert(results.end(), view.begin(), view.end());
+            }
+            return results;
+        }
+    };
+
     template<typename T, typename R = T>
     class Sequential : public Strategy<T, T, R>
     {
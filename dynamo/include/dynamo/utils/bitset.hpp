@@ -0,0 +1,158 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+@file dynamo/utils/bitset.hpp
+@brief Defines a resizable bitset whose words can be manipulated directly
+*/
+namespace dynamo
+{
+	/**
+	@class DynamicBitset
+
+	@brief Resizable bitset packed in 64-bit words. Unlike @c std::vector<bool>, words are exposed
+	so that set operations run one word (64 bits) at a time.
+
+	Bits past @c size() in the last word are always kept to 0.
+	*/
+	class DynamicBitset
+	{
+	public:
+		using word_t = std::uint64_t;
+		static constexpr size_t bits_per_word = 64;
+
+		DynamicBitset() = default;
+
+		/**
+		@brief Construct a bitset of @c size bits, all set to @c value.
+		*/
+		explicit DynamicBitset(size_t size, bool value = false) { resize(size, value); }
+
+		/**
+		@brief Resize to @c size bits. New bits are set to @c value.
+		*/
+		void resize(size_t size, bool value = false)
+		{
+			const size_t old_size = _size;
+			_words.resize(words_for(size), value ? ~word_t{ 0 } : word_t{ 0 });
+			_size = size;
+			if (value && old_size < size && old_size % bits_per_word != 0)
+				_words[old_size / bits_per_word] |= ~word_t{ 0 } << (old_size % bits_per_word);
+			clear_tail();
+		}
+
+		inline size_t size() const { return _size; }
+		inline size_t num_words() const { return _words.size(); }
+
+		inline bool test(size_t i) const { return (_words[i / bits_per_word] >> (i % bits_per_word)) & 1; }
+
+		inline void set(size_t i, bool value = true)
+		{
+			const word_t mask = word_t{ 1 } << (i % bits_per_word);
+			if (value)
+				_words[i / bits_per_word] |= mask;
+			else
+				_words[i / bits_per_word] &= ~mask;
+		}
+
+		inline void reset(size_t i) { set(i, false); }
+
+		inline void set_all()
+		{
+			std::fill(_words.begin(), _words.end(), ~word_t{ 0 });
+			clear_tail();
+		}
+
+		inline void reset_all() { std::fill(_words.begin(), _words.end(), word_t{ 0 }); }
+
+		/**
+		@brief Clear every bit from index @c n onwards.
+		*/
+		void keep_first(size_t n)
+		{
+			if (n >= _size)
+				return;
+			const size_t first = n / bits_per_word;
+			if (n % bits_per_word != 0)
+				_words[first] &= (word_t{ 1 } << (n % bits_per_word)) - 1;
+			else
+				_words[first] = 0;
+			std::fill(_words.begin() + first + 1, _words.end(), word_t{ 0 });
+		}
+
+		/**
+		@brief Number of bits set.
+		*/
+		size_t count() const
+		{
+			size_t n = 0;
+			for (auto word : _words)
+				n += std::popcount(word);
+			return n;
+		}
+
+		inline bool any() const { return std::any_of(_words.begin(), _words.end(), [](word_t w) { return w != 0; }); }
+		inline bool none() const { return !any(); }
+
+		DynamicBitset& operator&=(const DynamicBitset& other)
+		{
+			const size_t n = std::min(_words.size(), other._words.size());
+			for (size_t w = 0; w < n; w++)
+				_words[w] &= other._words[w];
+			std::fill(_words.begin() + n, _words.end(), word_t{ 0 });
+			return *this;
+		}
+
+		DynamicBitset& operator|=(const DynamicBitset& other)
+		{
+			const size_t n = std::min(_words.size(), other._words.size());
+			for (size_t w = 0; w < n; w++)
+				_words[w] |= other._words[w];
+			return *this;
+		}
+
+		friend bool operator==(const DynamicBitset& a, const DynamicBitset& b)
+		{
+			return a._size == b._size && a._words == b._words;
+		}
+
+		/**
+		@brief Call @c func with the index of each bit set, in increasing order.
+		@tparam F Accept function with following signature : @c std::function<void(size_t)>
+		*/
+		template<typename F>
+		void for_each(F&& func) const
+		{
+			for (size_t w = 0; w < _words.size(); w++)
+			{
+				word_t word = _words[w];
+				while (word)
+				{
+					func(w * bits_per_word + std::countr_zero(word));
+					word &= word - 1;
+				}
+			}
+		}
+
+		inline word_t* data() { return _words.data(); }
+		inline const word_t* data() const { return _words.data(); }
+
+	private:
+		static constexpr size_t words_for(size_t size) { return (size + bits_per_word - 1) / bits_per_word; }
+
+		void clear_tail()
+		{
+			if (_size % bits_per_word != 0)
+				_words.back() &= (word_t{ 1 } << (_size % bits_per_word)) - 1;
+		}
+
+	private:
+		std::vector<word_t> _words{};
+		size_t _size{ 0 };
+	};
+}
@@ -102,10 +102,11 @@ public:
 	}
 
 	std::optional<T> pop() {
+		std::lock_guard<std::mutex> lock(mutex_);
 		if (queue_.empty()) {
 			return std::nullopt;
 		}
-		T tmp = queue_.front();
+		T tmp = std::move(queue_.front());
 		queue_.pop();
 		return tmp;
 	}
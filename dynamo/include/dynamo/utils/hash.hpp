@@ -0,0 +1,64 @@
+#pragma once
+
+#include <concepts>
+#include <cstddef>
+#include <functional>
+#include <ranges>
+
+/**
+@file dynamo/utils/hash.hpp
+@brief Defines some hashing helpers used by the library
+*/
+namespace dynamo
+{
+	template<typename T>
+	concept StdHashable = requires(const T& value) {
+		{ std::hash<T>{}(value) } -> std::convertible_to<size_t>;
+	};
+
+	/**
+	@brief Types accepted by @c hash_value(...) : those with a @c std::hash specialisation, and ranges of them.
+	*/
+	template<typename T>
+	concept Hashable = StdHashable<T> || (std::ranges::range<const T> && StdHashable<std::ranges::range_value_t<const T>>);
+
+	/**
+	@brief Mix the hash of @c value into @c seed (same mixing as boost::hash_combine).
+	*/
+	template<typename T>
+	inline void hash_combine(size_t& seed, const T& value);
+
+	/**
+	@brief Returns the hash of @c value, combining the hashes of its elements if it is a range.
+	*/
+	template<Hashable T>
+	inline size_t hash_value(const T& value)
+	{
+		if constexpr (StdHashable<T>)
+			return std::hash<T>{}(value);
+		else
+		{
+			size_t seed = 0;
+			for (const auto& element : value)
+				hash_combine(seed, element);
+			return seed;
+		}
+	}
+
+	template<typename T>
+	inline void hash_combine(size_t& seed, const T& value)
+	{
+		seed ^= hash_value(value) + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2);
+	}
+
+	/**
+	@brief Returns the combined hash of all @c values.
+	*/
+	template<typename ... T>
+	inline size_t hash_of(const T& ... values)
+	{
+		size_t seed = 0;
+		(hash_combine(seed, values), ...);
+		return seed;
+	}
+}
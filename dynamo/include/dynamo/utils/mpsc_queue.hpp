@@ -0,0 +1,156 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+
+/**
+@file dynamo/utils/mpsc_queue.hpp
+@brief Bounded lock-free multi-producer / single-consumer queue.
+
+Based on Dmitry Vyukov's bounded MPMC queue : each cell carries a sequence number telling producers
+and the consumer whether it is free or filled. Producers only contend on the tail index (one CAS per push),
+the consumer never writes to the tail and no memory is allocated after construction.
+*/
+namespace dynamo
+{
+	/**
+	@class MpscQueue
+
+	@brief Bounded lock-free queue. Any thread can push, only one thread at a time may pop.
+
+	@tparam T Type of stored elements. Must be default constructible and move assignable.
+
+	Usage :
+	@code{.cpp}
+	MpscQueue<int> queue(1024);
+	queue.try_push(42);         // From any thread, returns false if full.
+	queue.drain([](int&& value) // From the consumer thread only.
+	{
+		// ...
+	});
+	@endcode
+	*/
+	template<typename T>
+	class MpscQueue
+	{
+		static constexpr size_t cacheline_size = 64;
+
+		struct Cell
+		{
+			std::atomic<size_t> sequence;
+			T value;
+		};
+
+	public:
+		/**
+		@brief Construct a queue holding at least @c capacity elements (rounded up to a power of 2).
+		*/
+		explicit MpscQueue(size_t capacity = 1024) :
+			_mask{ round_up(capacity) - 1 },
+			_cells{ std::make_unique<Cell[]>(_mask + 1) }
+		{
+			for (size_t i = 0; i <= _mask; i++)
+				_cells[i].sequence.store(i, std::memory_order_relaxed);
+		}
+
+		MpscQueue(const MpscQueue&) = delete;
+		MpscQueue& operator=(const MpscQueue&) = delete;
+
+		/**
+		@brief Push @c value. Lock-free, can be called from any thread. Returns @c false if the queue is full.
+		*/
+		bool try_push(T value)
+		{
+			size_t pos = _tail.load(std::memory_order_relaxed);
+			Cell* cell;
+			for (;;)
+			{
+				cell = &_cells[pos & _mask];
+				const size_t seq = cell->sequence.load(std::memory_order_acquire);
+				const auto diff = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos);
+				if (diff == 0)
+				{
+					if (_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+						break;
+				}
+				else if (diff < 0)
+				{
+					return false;
+				}
+				else
+				{
+					pos = _tail.load(std::memory_order_relaxed);
+				}
+			}
+			cell->value = std::move(value);
+			cell->sequence.store(pos + 1, std::memory_order_release);
+			return true;
+		}
+
+		/**
+		@brief Pop the oldest element, if any. Consumer thread only.
+		*/
+		std::optional<T> try_pop()
+		{
+			const size_t head = _head.load(std::memory_order_relaxed);
+			Cell& cell = _cells[head & _mask];
+			const size_t seq = cell.sequence.load(std::memory_order_acquire);
+			if (static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(head + 1) < 0)
+				return std::nullopt;
+
+			std::optional<T> value{ std::move(cell.value) };
+			cell.value = T{}; // Release resources held by the cell right away.
+			cell.sequence.store(head + _mask + 1, std::memory_order_release);
+			_head.store(head + 1, std::memory_order_relaxed);
+			return value;
+		}
+
+		/**
+		@brief Pop every available element and pass it to @c func. Consumer thread only. Returns the number of elements popped.
+
+		@tparam F Accept function with following signature : @c std::function<void(T&&)>
+		*/
+		template<typename F>
+		size_t drain(F&& func)
+		{
+			size_t count = 0;
+			while (auto value = try_pop())
+			{
+				func(std::move(*value));
+				count++;
+			}
+			return count;
+		}
+
+		/**
+		@brief Maximum number of elements.
+		*/
+		inline size_t capacity() const { return _mask + 1; }
+
+		/**
+		@brief Approximate number of elements, as producers may be pushing concurrently.
+		*/
+		inline size_t size_approx() const
+		{
+			return _tail.load(std::memory_order_relaxed) - _head.load(std::memory_order_relaxed);
+		}
+
+	private:
+		static size_t round_up(size_t n)
+		{
+			size_t capacity = 2;
+			while (capacity < n)
+				capacity <<= 1;
+			return capacity;
+		}
+
+	private:
+		const size_t				_mask;
+		std::unique_ptr<Cell[]>		_cells;
+		alignas(cacheline_size) std::atomic<size_t> _tail{ 0 };
+		alignas(cacheline_size) std::atomic<size_t> _head{ 0 };
+	};
+}
@@ -11,24 +11,56 @@ namespace dynamo {
         auto e = world.component<perceive>();
         e.add(flecs::Transitive);
 
+        world.component<PerceivedSources>();
+        world.component<Perceivers>();
+
+        world.set<Snapshots>({});
+        world.set<Memoization>({});
+        world.set<Routines>({});
+        world.set<ReasoningBudget>({});
+
+        // =========================================================================== 
+        // Observers
+        // =========================================================================== 
+
+        // Keep the closure of entities perceiving an expiring entity up-to-date, transitively.
+        world.observer<const Perceivers>("OnRemove_Perceivers_UpdateClosure")
+            .event(flecs::OnRemove)
+            .each([](flecs::entity perceived, const Perceivers& perceivers) {
+            detail::unlink_perceived(perceived);
+                });
+
         // =========================================================================== 
         // Pipeline
         // =========================================================================== 
 
+        world.set<Clock>({});
+        world.system<>("Clock")
+            .kind(flecs::PreFrame)
+            .iter([](flecs::iter& iter) {
+            iter.world().get_mut<Clock>()->time += iter.delta_time();
+                });
+
+        // Built-in systems below run on flecs worker stages : structural changes (destruct, remove) are deferred
+        // on each stage and merged at the end of the pipeline.
         auto decay_system = world.system<Decay>("Decay")
             .kind(flecs::PreFrame)
-            .each([](flecs::entity e, Decay& decay) {
-            if (decay.ttl <= 0.f) {
-                e.destruct();
-            }
-            else {
-                decay.ttl -= e.delta_time();
+            .multi_threaded(true)
+            .iter([](flecs::iter& iter, Decay* decay) {
+            for (auto i : iter) {
+                if (decay[i].ttl <= 0.f) {
+                    iter.entity(i).destruct();
+                }
+                else {
+                    decay[i].ttl -= iter.delta_time();
+                }
             }
                 });
 
         world.system<Cooldown>("Cooldown linked")
             .arg(1).obj(flecs::Wildcard) // <- Cooldown is actually a pair type with anything
             .kind(flecs::PreFrame)
+            .multi_threaded(true)
             .iter([](flecs::iter& iter, Cooldown* cooldown) {
             for (auto i : iter) {
                 cooldown[i].remaining_time -= iter.delta_time();
@@ -40,6 +72,7 @@ namespace dynamo {
 
         world.system<Cooldown>("Cooldown single")
             .kind(flecs::PreFrame)
+            .multi_threaded(true)
             .iter([](flecs::iter& iter, Cooldown* cooldown) {
             for (auto i : iter) {
                 cooldown[i].remaining_time -= iter.delta_time();
@@ -49,8 +82,25 @@ namespace dynamo {
             }
         });
 
+        // Jobs run inline when no scheduler (e.g a Simulation) takes care of them.
+        world.set<Jobs>({});
+        world.system<>("Jobs")
+            .kind(flecs::PreUpdate)
+            .iter([](flecs::iter& iter) {
+            auto jobs = iter.world().get<Jobs>();
+            if (jobs->scheduled)
+                return;
+            std::vector<JobChunk> chunks{};
+            jobs->split(iter.delta_time(), false, chunks);
+            jobs->split(iter.delta_time(), true, chunks);
+            for (auto& chunk : chunks) {
+                chunk();
+            }
+                });
+
         world.system<CurrentFrame>("RemoveCurrentFrameTag")
             .kind(flecs::PostFrame)
+            .multi_threaded(true)
             .each([](flecs::entity e, CurrentFrame) {
             e.remove<CurrentFrame>();
                 });
@@ -1,22 +1,81 @@
 #include <dynamo/simulation.hpp>
 
+#include <algorithm>
+
+namespace
+{
+	// Threads given to flecs worker stages, taken from the executor's share. Built-in systems are light compared
+	// to flows, and in pipelined mode both pools run at the same time.
+	size_t system_threads(size_t number_of_threads)
+	{
+		return number_of_threads >= 8 ? number_of_threads / 4 : 0;
+	}
+
+	// Flags executor threads while tasks may overlap the world progressing, see detail::world_progressing.
+	class ProgressingWorld : public tf::ObserverInterface
+	{
+	public:
+		explicit ProgressingWorld(const dynamo::StepMode& mode) : mode{ mode } {}
+
+		void set_up(size_t num_workers) override final {}
+
+		void on_entry(tf::WorkerView w, tf::TaskView tv) override final
+		{
+			dynamo::detail::world_progressing = mode == dynamo::StepMode::Pipelined;
+		}
+
+		void on_exit(tf::WorkerView w, tf::TaskView tv) override final
+		{
+			dynamo::detail::world_progressing = false;
+		}
+
+	private:
+		const dynamo::StepMode& mode;
+	};
+}
+
 dynamo::Simulation::Simulation() : Simulation(std::thread::hardware_concurrency() - 1) {}
 
-dynamo::Simulation::Simulation(size_t number_of_threads) : executor{ number_of_threads } {
+dynamo::Simulation::Simulation(size_t number_of_threads) : executor{ std::max<size_t>(number_of_threads - system_threads(number_of_threads), 1) } {
+	running_tasks = executor.make_observer<RunningTasks>();
+	profiler = executor.make_observer<TaskProfiler>();
+	executor.make_observer<ProgressingWorld>(mode);
 	_world.import<module::Core>();
 	_world.import<module::GlobalPerception>();
 	_world.import<module::BasicAction>();
 	//_world.set<flecs::rest::Rest>({});
 	_world.set<CommandsQueueHandle>({ &commands_queue });
 
+	// Multi-threaded systems (e.g Decay, Cooldown) run on flecs worker stages during progress. Otherwise, they run on
+	// the main thread.
+	if (const auto threads = system_threads(number_of_threads); threads > 1)
+		_world.set_threads(static_cast<int32_t>(threads));
+
+	// Jobs run on the executor, so they can overlap flows.
+	_world.get_mut<Jobs>()->scheduled = true;
+
 	agents_query = _world.query<const dynamo::type::Agent>();
+
+	// A removed flow may still be running : its taskflow is kept alive until the executor is done.
+	_world.observer<Flow>()
+		.event(flecs::OnRemove)
+		.each([this](flecs::entity e, Flow& flow)
+		{
+			if (!flow.taskflow)
+				return;
+			profiler->untrack(*flow.taskflow);
+			retired_flows.push_back(std::move(flow.taskflow));
+		}
+	);
+
+	// Manual system (no phase), run by step() once the world has progressed.
 	flows = _world.system<Flow, Status, const Cyclic, const Launch>()
+		.kind(0)
 		.iter([this](flecs::iter& it, Flow* flow, Status* status, const Cyclic* cycle, const Launch* _)
 		{
 			for (auto i : it)
 			{
-				auto e = it.entity(i);
-				status[i].value = executor.run(flow[i].taskflow);
+				queue_flow(it.entity(i));
 				//status[i].value = executor.run(flow[i].taskflow,
 				//	[id = e.id(), period = cycle[i].period, this]()
 				//{
@@ -30,12 +89,22 @@ dynamo::Simulation::Simulation(size_t number_of_threads) : executor{ number_of_t
 	);
 }
 
+dynamo::Simulation::~Simulation() {
+	shutdown();
+}
+
 void dynamo::Simulation::shutdown() {
 	_world.each<Status>([](flecs::entity e, Status& status)
 		{
 			status.cancel();
 		});
+	flow_lanes.clear();
+	queued_flows.clear();
+	watched_flows.clear();
+	expired_flows.clear();
+	backed_off_flows.clear();
 	executor.wait_for_all();
+	retired_flows.clear();
 }
 
 dynamo::Action dynamo::Simulation::action(const char* name) {
@@ -65,21 +134,416 @@ dynamo::Artefact dynamo::Simulation::artefact(const char* name) {
 }
 
 bool dynamo::Simulation::step(float elapsed_time) {
+	using clock = std::chrono::steady_clock;
+	const auto start = clock::now();
+	auto last = start;
+	auto lap = [&last]() {
+		const auto now = clock::now();
+		const std::chrono::duration<double, std::milli> elapsed = now - last;
+		last = now;
+		return elapsed;
+	};
+	StepTimings timings{};
+
+	// In pipelined mode, flows launched during the previous step are still running.
 	bool should_quit = _world.progress(elapsed_time);
+	flush_emissions(_world);
+	const float delta_time = _world.delta_time();
+	timings.progress = lap();
 
-	flows.run();
-	executor.wait_for_all();
+	if (mode == StepMode::Sequential)
+	{
+		// Jobs that may touch what flows read are run first, the others are run while flows are running.
+		run_jobs(jobs_taskflow, delta_time, false).wait();
+		timings.jobs = lap();
+
+		_world.get<Snapshots>()->registry->capture();
+		_world.get<Memoization>()->cache->advance();
+		resume_routines(delta_time);
+		begin_reasoning();
+		flows.run();
+		launch_triggered_flows();
+		run_jobs(overlapping_jobs_taskflow, delta_time, true);
+		dispatch_flows(true);
+		watch_flows();
+		executor.wait_for_all();
+		retired_flows.clear();
+		back_off_flows();
+		timings.flows = lap();
+
+		apply_commands(commands_queue.size());
+		timings.commands = lap();
+	}
+	else
+	{
+		// Flows only read snapshots, so all jobs can overlap them. They must be done before commands are applied.
+		auto jobs = run_jobs(jobs_taskflow, delta_time, false);
+		auto overlapping_jobs = run_jobs(overlapping_jobs_taskflow, delta_time, true);
+		jobs.wait();
+		overlapping_jobs.wait();
+		timings.jobs = lap();
+
+		// Flows deferred by the previous step are launched until the rest of its budget is spent.
+		resume_reasoning();
+		dispatch_flows(true);
+		watch_flows();
+		executor.wait_for_all();
+		retired_flows.clear();
+		back_off_flows();
+		timings.flows = lap();
+
+		// Commands pushed by the previous flows are applied while the next ones are running.
+		const size_t pending = commands_queue.size();
+		_world.get<Snapshots>()->registry->capture();
+		_world.get<Memoization>()->cache->advance();
+		resume_routines(delta_time);
+		begin_reasoning();
+		flows.run();
+		launch_triggered_flows();
+		dispatch_flows(false);
+		apply_commands(pending);
+		pause_reasoning();
+		timings.commands = lap();
+	}
+
+	timings.total = clock::now() - start;
+	step_timings = timings;
+	return should_quit;
+}
+
+void dynamo::Simulation::step_mode(StepMode value) {
+	if (mode == StepMode::Pipelined && value == StepMode::Sequential)
+	{
+		executor.wait_for_all();
+		apply_commands(commands_queue.size());
+	}
+	mode = value;
+}
+
+void dynamo::Simulation::trigger(const FlowRegistry& registry, flecs::entity agent) {
+	if (auto it = registry.flows.find(agent.id()); it != registry.flows.end())
+		triggered_flows.insert(it->second);
+}
+
+void dynamo::Simulation::launch_triggered_flows() {
+	for (const auto& [_, registry] : flow_registries)
+	{
+		if (!registry->always)
+			continue;
+		for (const auto& [agent, flow] : registry->flows)
+			triggered_flows.insert(flow);
+	}
+
+	for (auto it = triggered_flows.begin(); it != triggered_flows.end();)
+	{
+		auto e = flecs::entity(_world, *it);
+		if (!e.is_alive())
+		{
+			it = triggered_flows.erase(it);
+			continue;
+		}
+
+		auto status = e.get_mut<Status>(); // Added with the flow, see flow<T>()
+		if (status->value.valid() && !status->is_finished())
+		{
+			++it; // Still running, launched again once done.
+			continue;
+		}
+		queue_flow(e);
+		it = triggered_flows.erase(it);
+	}
+}
+
+void dynamo::Simulation::resume_routines(float delta_time) {
+	auto scheduler = _world.get<Routines>()->scheduler;
+	scheduler->advance(delta_time);
+
+	std::vector<RoutineScheduler::Wait> ready{};
+	scheduler->poll(ready);
+	for (auto& wait : ready)
+	{
+		// The wait keeps the frame alive until the routine suspends again or is done.
+		executor.silent_async([wait = std::move(wait)]() { RoutineSlot::resume(wait.slot, wait.handle); });
+	}
+}
+
+void dynamo::Simulation::begin_reasoning() {
+	reasoning_deadline = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(budget);
+	_world.get_mut<ReasoningBudget>()->token.reset();
+	critical_paths.clear();
+}
+
+void dynamo::Simulation::pause_reasoning() {
+	reasoning_left = std::max(std::chrono::steady_clock::duration::zero(), reasoning_deadline - std::chrono::steady_clock::now());
+}
+
+void dynamo::Simulation::resume_reasoning() {
+	reasoning_deadline = std::chrono::steady_clock::now() + reasoning_left;
+}
+
+void dynamo::Simulation::queue_flow(flecs::entity flow) {
+	if (!queued_flows.insert(flow.id()).second)
+		return;
+
+	int priority = 0;
+	if (auto p = flow.get<Priority>())
+		priority += p->value;
+	if (auto agent = flow.get_object(flecs::ChildOf); agent.is_valid())
+	{
+		if (auto p = agent.get<Priority>())
+			priority += p->value;
+	}
+	double rank = 0.;
+	if (critical_path_first)
+	{
+		// Flows of a type share their profile : its critical path is computed once per step.
+		if (auto profile = flow.get<Profile>())
+		{
+			auto [it, inserted] = critical_paths.try_emplace(profile->value.get(), 0.);
+			if (inserted)
+				it->second = profile->value->critical_path();
+			rank = it->second;
+		}
+	}
+	flow_lanes[priority].push_back({ flow.id(), priority, _world.get_tick(), std::chrono::steady_clock::now(), rank });
+}
+
+dynamo::Simulation::QueuedFlow dynamo::Simulation::next_flow() {
+	const std::int64_t tick = _world.get_tick();
+	auto best = flow_lanes.end();
+	std::int64_t best_rank = 0;
+	// Lanes are ordered by decreasing priority, so ties go to the higher one.
+	for (auto it = flow_lanes.begin(); it != flow_lanes.end(); ++it)
+	{
+		if (it->second.empty())
+			continue;
+		const auto& front = it->second.front();
+		const std::int64_t rank = front.priority + (aging ? (tick - front.tick) / static_cast<std::int64_t>(aging) : 0);
+		if (best == flow_lanes.end() || rank > best_rank)
+		{
+			best = it;
+			best_rank = rank;
+		}
+	}
+
+	auto queued = best->second.front();
+	best->second.pop_front();
+	queued_flows.erase(queued.flow);
+	return queued;
+}
+
+void dynamo::Simulation::dispatch_flows(bool wait) {
+	const bool budgeted = budget.count() > 0;
+	const bool windowed = budgeted || mode == StepMode::Sequential;
+	const size_t workers = std::max<size_t>(1, executor.num_workers());
+	auto free_worker = [this, workers]() { return flows_in_flight < 2 * workers; };
+
+	// Within a lane, flows deferred the longest go first, then the longest flows.
+	if (critical_path_first)
+	{
+		for (auto& [_, lane] : flow_lanes)
+		{
+			std::stable_sort(lane.begin(), lane.end(), [](const QueuedFlow& a, const QueuedFlow& b)
+				{
+					return a.tick != b.tick ? a.tick < b.tick : a.rank > b.rank;
+				});
+		}
+	}
+
+	std::unique_lock lock{ dispatch_mutex };
+	while (!queued_flows.empty())
+	{
+		if (budgeted && std::chrono::steady_clock::now() >= reasoning_deadline)
+			break;
+		if (windowed && !free_worker())
+		{
+			if (!wait)
+				break;
+			// Woken up at the next expiry as well : cancelling an overrunning flow frees its worker sooner.
+			auto until = next_expiry();
+			if (budgeted)
+				until = std::min(until, reasoning_deadline);
+			if (until == std::chrono::steady_clock::time_point::max())
+				dispatch_cv.wait(lock, free_worker);
+			else
+				dispatch_cv.wait_until(lock, until, free_worker);
+			lock.unlock();
+			expire_flows(std::chrono::steady_clock::now());
+			lock.lock();
+			continue;
+		}
+
+		const auto queued = next_flow();
+		auto e = flecs::entity(_world, queued.flow);
+		if (!e.is_alive())
+			continue;
+
+		auto& stats = queueing_stats[queued.priority];
+		const std::chrono::duration<double, std::milli> delay = std::chrono::steady_clock::now() - queued.since;
+		stats.count++;
+		stats.total += delay;
+		stats.max = std::max(stats.max, delay);
+
+		flows_in_flight++;
+		lock.unlock();
+		e.get_mut<Status>()->value = executor.run(*e.get<Flow>()->taskflow, [this, workers]()
+			{
+				bool notify;
+				{
+					std::lock_guard guard{ dispatch_mutex };
+					flows_in_flight--;
+					notify = flows_in_flight <= workers;
+				}
+				// Woken up once half of the window is free, or once every flow is done.
+				if (notify)
+					dispatch_cv.notify_all();
+			});
+		e.modified<Status>();
+		watch(e);
+		lock.lock();
+	}
+
+	if (!wait || !budgeted)
+		return;
+
+	// Remaining flows are deferred. Running ones are awaited, but their anytime processes give up once out of time.
+	auto all_done = [this]() { return flows_in_flight == 0; };
+	while (!dispatch_cv.wait_until(lock, std::min(next_expiry(), reasoning_deadline), all_done))
+	{
+		if (std::chrono::steady_clock::now() >= reasoning_deadline)
+		{
+			_world.get_mut<ReasoningBudget>()->token.cancel();
+			return;
+		}
+		lock.unlock();
+		expire_flows(std::chrono::steady_clock::now());
+		lock.lock();
+	}
+}
 
-	size_t size = commands_queue.size();    // Since size can be updated between loops (async),
-											// we must check only once, not at every loop !
-	for (int i = 0; i < size; i++)
+void dynamo::Simulation::watch(flecs::entity flow) {
+	if (auto deadline = flow.get<Deadline>())
+	{
+		watched_flows.emplace_back(flow.id(), std::chrono::steady_clock::now()
+			+ std::chrono::duration_cast<std::chrono::steady_clock::duration>(deadline->value));
+	}
+}
+
+std::chrono::steady_clock::time_point dynamo::Simulation::next_expiry() const {
+	auto next = std::chrono::steady_clock::time_point::max();
+	for (const auto& [_, expiry] : watched_flows)
+		next = std::min(next, expiry);
+	return next;
+}
+
+void dynamo::Simulation::expire_flows(std::chrono::steady_clock::time_point now) {
+	std::erase_if(watched_flows, [this, now](const auto& watched)
+		{
+			if (watched.second > now)
+				return false;
+			expire(flecs::entity(_world, watched.first), watched.second);
+			return true;
+		});
+}
+
+void dynamo::Simulation::expire(flecs::entity e, std::chrono::steady_clock::time_point expiry) {
+	if (!e.is_alive())
+		return;
+	auto status = e.get_mut<Status>();
+	if (!status->value.valid() || status->value.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+		return;
+
+	status->cancel();
+	const auto deadline = *e.get<Deadline>();
+
+	FlowOverrun overrun{ e.get_object(flecs::ChildOf).id(), e.id(), e.name().c_str(), "", deadline.value, _world.get_tick() };
+	if (auto details = e.get<type::ProcessDetails>())
+	{
+		running_tasks->each([&overrun, details](size_t hash)
+			{
+				for (const auto& [logical, executed] : details->execution)
+				{
+					if (executed != hash)
+						continue;
+					if (!overrun.processes.empty())
+						overrun.processes += ", ";
+					overrun.processes += details->find(logical).task().name();
+				}
+			});
+	}
+	const auto grace = std::chrono::duration_cast<std::chrono::steady_clock::duration>(deadline.value);
+	expired_flows.emplace_back(e.id(), expiry + grace, flow_overruns.size());
+	flow_overruns.push_back(std::move(overrun));
+
+	// The flow is still running : it is only paused once the executor is done, see back_off_flows().
+	if (deadline.back_off > 1.f && e.has<Cyclic>())
+		backed_off_flows.push_back(e.id());
+}
+
+void dynamo::Simulation::watch_flows() {
+	for (const auto& [id, expiry] : watched_flows)
+	{
+		auto e = flecs::entity(_world, id);
+		if (!e.is_alive())
+			continue;
+		auto status = e.get<Status>();
+		if (!status->value.valid() || status->value.wait_until(expiry) == std::future_status::ready)
+			continue;
+		expire(e, expiry);
+	}
+	watched_flows.clear();
+
+	// The running task can't be interrupted : the step is stalled until it returns.
+	for (const auto& [id, stall, overrun] : expired_flows)
+	{
+		auto e = flecs::entity(_world, id);
+		auto status = e.is_alive() ? e.get<Status>() : nullptr;
+		if (!status || !status->value.valid())
+			continue;
+		flow_overruns[overrun].stalled = status->value.wait_until(stall) != std::future_status::ready;
+	}
+	expired_flows.clear();
+}
+
+void dynamo::Simulation::back_off_flows() {
+	for (const auto id : backed_off_flows)
+	{
+		auto e = flecs::entity(_world, id);
+		if (!e.is_alive())
+			continue;
+
+		// Pausing the flow for its new period : it is launched again once the cooldown is over.
+		const auto deadline = *e.get<Deadline>();
+		auto cycle = e.get_mut<Cyclic>();
+		const float base = std::max(cycle->period, static_cast<float>(deadline.value.count() / 1000.));
+		cycle->period = std::min(deadline.max_period, base * deadline.back_off);
+		e.remove<Launch>();
+		e.remove<Status>();
+		e.set<Cooldown>({ cycle->period });
+	}
+	backed_off_flows.clear();
+}
+
+void dynamo::Simulation::apply_commands(size_t count) {
+	for (size_t i = 0; i < count; i++)
 	{
 		auto command = commands_queue.pop();
 		if (command && command.value()) // BUG : Somehow some commands are empty
 			command.value()(_world);
 	}
+}
 
-	return should_quit;
+tf::Future<void> dynamo::Simulation::run_jobs(tf::Taskflow& taskflow, float delta_time, bool overlapping) {
+	std::vector<JobChunk> chunks{};
+	auto jobs = _world.get<Jobs>();
+	if (jobs->scheduled) // Otherwise, they already ran inline during progress.
+		jobs->split(delta_time, overlapping, chunks);
+	taskflow.clear();
+	for (auto& chunk : chunks)
+	{
+		taskflow.emplace(std::move(chunk));
+	}
+	return executor.run(taskflow);
 }
 
 void dynamo::Simulation::step_n(unsigned int n, float elapsed_time) {
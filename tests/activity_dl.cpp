@@ -0,0 +1,145 @@
+#include <doctest/doctest.h>
+#include <dynamo/simulation.hpp>
+#include <dynamo/modules/activity_dl.hpp>
+
+TEST_SUITE_BEGIN("ADL");
+
+TEST_CASE("Feasibility") {
+    using namespace dynamo;
+    auto sim = Simulation();
+    sim.world().import<module::ADL>();
+
+    auto easy = sim.action("Easy").set<type::Qualification>({ 1 }).entity();
+    auto hard = sim.action("Hard").set<type::Qualification>({ 3 }).entity();
+    auto blocked = sim.action("Blocked")
+        .set<type::Qualification>({ 1 })
+        .set<type::PreCondition_Contextual>({ 0 })
+        .entity();
+
+    auto novice = sim.agent("Novice").set<type::Qualification>({ 1 }).entity();
+    auto expert = sim.agent("Expert").set<type::Qualification>({ 5 }).entity();
+    sim.step();
+
+    auto feasible = [](flecs::entity agent) {
+        std::vector<flecs::entity> actions{};
+        for_each_feasible(agent, [&actions](flecs::entity action) { actions.push_back(action); });
+        return actions;
+    };
+
+    SUBCASE("Qualification and preconditions"){
+        CHECK(feasible(novice) == std::vector<flecs::entity>{ easy });
+        auto actions = feasible(expert);
+        CHECK(actions.size() == 2);
+        CHECK(std::find(actions.begin(), actions.end(), hard) != actions.end());
+        CHECK(std::find(actions.begin(), actions.end(), blocked) == actions.end());
+    }
+
+    SUBCASE("Incremental updates"){
+        novice.set<type::Qualification>({ 3 });
+        blocked.set<type::PreCondition_Contextual>({ 1 });
+        sim.step();
+        CHECK(feasible(novice).size() == 3);
+        CHECK(feasible(expert).size() == 3);
+    }
+}
+
+TEST_CASE("Task trees") {
+    using namespace dynamo;
+    auto sim = Simulation();
+    sim.world().import<module::ADL>();
+
+    // Root (AND, SEQ_ORD) : [ Prepare (OR) : [ Call, Radio ] ], Intervene
+    auto root = sim.world().entity("Root")
+        .add<type::Root>()
+        .set<TemporalConstructor>(TemporalConstructor::SEQ_ORD);
+    auto prepare = sim.world().entity("Prepare")
+        .add<type::Task>()
+        .set<LogicalConstructor>(LogicalConstructor::OR)
+        .child_of(root);
+    auto call = sim.action("Call").entity().child_of(prepare);
+    auto radio = sim.action("Radio").entity().child_of(prepare);
+    auto intervene = sim.action("Intervene").entity().child_of(root);
+
+    compile_tree(root);
+    const auto& tree = root.get<CompiledTaskTree>()->tree;
+    CHECK(tree.size() == 5);
+    CHECK(tree.find(call.id()) == 2);
+    CHECK(tree.end(tree.find(prepare.id())) == 4);
+
+    auto agent = sim.agent("Agent").entity();
+    follow(agent, root);
+    sim.step();
+
+    auto eligible = [&agent]() {
+        std::vector<flecs::entity> leaves{};
+        for_each_eligible(agent, [&leaves](flecs::entity leaf) { leaves.push_back(leaf); });
+        return leaves;
+    };
+
+    CHECK(eligible() == std::vector<flecs::entity>{ call, radio });
+
+    SUBCASE("Trees are compiled again when modified"){
+        radio.set<type::PreCondition_Contextual>({ 0 });
+        auto wait = sim.action("Wait").entity().child_of(prepare);
+        sim.step(); // Compiled again
+        sim.step(); // Followers evaluated
+        CHECK(root.get<CompiledTaskTree>()->tree.find(wait.id()) == 4);
+        CHECK(eligible() == std::vector<flecs::entity>{ call, wait });
+    }
+
+    task_progress(agent, radio);
+    CHECK(eligible() == std::vector<flecs::entity>{ intervene });
+    task_progress(agent, intervene);
+    CHECK(eligible().empty());
+}
+
+TEST_CASE("Allocation") {
+    using namespace dynamo;
+    auto sim = Simulation();
+    sim.world().import<module::ADL>();
+
+    auto carry = sim.action("Carry").set<type::Arity>({ 2 }).entity();
+    auto lift = sim.action("Lift").set<type::Arity>({ 2 }).entity();
+    auto watch = sim.action("Watch").entity();
+    auto operate = sim.action("Operate").set<type::Qualification>({ 5 }).entity();
+
+    std::vector<flecs::entity> agents{};
+    for(auto name : {"A", "B", "C"}){
+        agents.push_back(sim.agent(name).entity());
+    }
+
+    // Everyone prefers cooperative actions, no one is qualified to operate.
+    for(auto agent : agents){
+        propose(agent, operate, 1.f);
+        propose(agent, carry, 0.9f);
+        propose(agent, lift, 0.8f);
+        propose(agent, watch, 0.1f);
+    }
+    sim.step();
+
+    auto assigned = [](flecs::entity agent) { return agent.get<CurrentAction>()->action; };
+    CHECK(assigned(agents[0]) == carry.id());
+    CHECK(assigned(agents[1]) == carry.id());
+    CHECK(assigned(agents[2]) == watch.id()); // Lift would be understaffed.
+
+    SUBCASE("Proposals are consumed"){
+        propose(agents[0], watch);
+        sim.step();
+        CHECK(assigned(agents[0]) == watch.id());
+        CHECK(assigned(agents[1]) == 0); // Carry can't be performed alone.
+        CHECK(performers(carry).empty());
+    }
+
+    SUBCASE("Proposals exceeding the queue capacity are kept"){
+        sim.world().set<TaskAllocation>(TaskAllocation{ 2 });
+        for(auto agent : agents){
+            propose(agent, watch);
+        }
+        sim.step();
+        CHECK(sim.world().get<TaskAllocation>()->overflowed == 1);
+        CHECK(performers(watch).size() == 3);
+        CHECK(performers(carry).empty());
+    }
+}
+
+TEST_SUITE_END();
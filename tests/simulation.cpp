@@ -1,8 +1,257 @@
+#include <atomic>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
 #include <doctest/doctest.h>
 #include <dynamo/simulation.hpp>
+#include <dynamo/modules/messaging.hpp>
+#include <dynamo/modules/basic_stress.hpp>
+#include <dynamo/strategies/basic.hpp>
 
 TEST_SUITE_BEGIN("Simulation");
 
+struct Reasoned {};
+
+class TagFlow : public dynamo::FlowBuilder
+{
+public:
+    using FlowBuilder::FlowBuilder;
+
+    virtual constexpr const char* name() const { return "TagFlow"; }
+
+    void build() override
+    {
+        emplace([](dynamo::AgentHandle agent) { agent.add<Reasoned>(); });
+    }
+};
+
+struct Fatigue
+{
+    int value {0};
+    bool operator==(const Fatigue&) const = default;
+};
+
+std::atomic<int> fatigue_computations {0};
+std::atomic<int> rest_computations {0};
+
+class RestFlow : public dynamo::FlowBuilder
+{
+public:
+    using FlowBuilder::FlowBuilder;
+
+    virtual constexpr const char* name() const { return "RestFlow"; }
+
+    void build() override
+    {
+        auto fatigue = process<dynamo::strat::Random, int>();
+        fatigue.reads<Fatigue>();
+        auto rest = process<dynamo::strat::Random, bool, int>(fatigue);
+        rest.incremental();
+    }
+};
+
+std::atomic<int> plan_computations {0};
+
+class PlanFlow : public dynamo::FlowBuilder
+{
+public:
+    using FlowBuilder::FlowBuilder;
+
+    virtual constexpr const char* name() const { return "PlanFlow"; }
+
+    void build() override
+    {
+        process<dynamo::strat::Random, int>(dynamo::Memoized{});
+    }
+};
+
+struct Sleeping {};
+struct Working {};
+
+class FatigueModule : public dynamo::FlowBuilder
+{
+public:
+    using FlowBuilder::FlowBuilder;
+
+    virtual constexpr const char* name() const { return "FatigueModule"; }
+
+    void build() override
+    {
+        fatigue.emplace(process<dynamo::strat::Random, int>());
+    }
+
+    std::optional<dynamo::Process<int>> fatigue {};
+};
+
+class GateFlow : public dynamo::FlowBuilder
+{
+public:
+    using FlowBuilder::FlowBuilder;
+
+    virtual constexpr const char* name() const { return "GateFlow"; }
+
+    void build() override
+    {
+        auto module = compose<FatigueModule>();
+        auto fatigue = module.output(*module->fatigue);
+        auto gate = conditional<dynamo::strat::Random>(fatigue);
+        auto sleep = gate.branch("Sleep");
+        auto work = gate.branch("Work");
+
+        auto t0 = emplace([](dynamo::AgentHandle agent) { agent.add<Sleeping>(); });
+        t0.succeed(sleep);
+        auto t1 = emplace([](dynamo::AgentHandle agent) { agent.add<Working>(); });
+        t1.succeed(work);
+    }
+};
+
+class ChainFlow : public dynamo::FlowBuilder
+{
+public:
+    using FlowBuilder::FlowBuilder;
+
+    virtual constexpr const char* name() const { return "ChainFlow"; }
+
+    void build() override
+    {
+        auto two = static_value<int>(2);
+        auto four = process<dynamo::strat::Random, int, int>(two);
+        auto eight = process<dynamo::strat::Random, int, int>(four);
+        result = eight.output();
+    }
+
+    std::shared_ptr<int> result {};
+};
+
+struct Tiredness : dynamo::StaticProcess<dynamo::strat::Random, int> {};
+struct Needs : dynamo::StaticProcess<dynamo::strat::Random, int, Tiredness, Tiredness> {};
+struct Urge : dynamo::StaticProcess<dynamo::strat::Random, bool, Needs> {};
+struct Worry : dynamo::StaticProcess<dynamo::strat::Random, bool, Needs> {};
+
+using NeedsFlow = dynamo::StaticFlow<Urge, Worry, Needs, Tiredness>;
+
+class StaticNeedsFlow : public dynamo::StaticFlowBuilder<NeedsFlow>
+{
+public:
+    using StaticFlowBuilder::StaticFlowBuilder;
+
+    virtual constexpr const char* name() const { return "StaticNeedsFlow"; }
+};
+
+struct Waited {};
+struct Alerted {};
+
+class WaitingFlow : public dynamo::FlowBuilder
+{
+public:
+    using FlowBuilder::FlowBuilder;
+
+    virtual constexpr const char* name() const { return "WaitingFlow"; }
+
+    void build() override
+    {
+        routine([](dynamo::AgentHandle agent) -> dynamo::Routine
+            {
+                co_await dynamo::ticks(agent, 2);
+                agent.add<Waited>();
+                co_await dynamo::perceived<Hearing>(agent);
+                agent.add<Alerted>();
+            });
+    }
+};
+
+class FailingFlow : public dynamo::FlowBuilder
+{
+public:
+    using FlowBuilder::FlowBuilder;
+
+    virtual constexpr const char* name() const { return "FailingFlow"; }
+
+    void build() override
+    {
+        routine([](dynamo::AgentHandle agent) -> dynamo::Routine
+            {
+                co_await dynamo::ticks(agent, 0);
+                throw std::runtime_error("Routine failure");
+            });
+    }
+};
+
+std::atomic<int> deliberations {0};
+std::atomic<int> anytime_deliberations {0};
+std::atomic<int> interrupted_deliberations {0};
+
+class DeliberationFlow : public dynamo::FlowBuilder
+{
+public:
+    using FlowBuilder::FlowBuilder;
+
+    virtual constexpr const char* name() const { return "DeliberationFlow"; }
+
+    void build() override
+    {
+        auto deliberation = process<dynamo::strat::Random, int>();
+        deliberation.anytime();
+    }
+};
+
+std::atomic<int> slow_computations {0};
+
+class SlowFlow : public dynamo::FlowBuilder
+{
+public:
+    using FlowBuilder::FlowBuilder;
+
+    virtual constexpr const char* name() const { return "SlowFlow"; }
+
+    void build() override
+    {
+        auto slow = process<dynamo::strat::Random, int>();
+        slow.name("Slow");
+    }
+};
+
+std::mutex reasoning_order_mutex {};
+std::vector<std::string> reasoning_order {};
+
+class OrderFlow : public dynamo::FlowBuilder
+{
+public:
+    using FlowBuilder::FlowBuilder;
+
+    virtual constexpr const char* name() const { return "OrderFlow"; }
+
+    void build() override
+    {
+        emplace([](dynamo::AgentHandle agent)
+            {
+                std::lock_guard lock{ reasoning_order_mutex };
+                reasoning_order.emplace_back(agent.entity().name().c_str());
+            });
+    }
+};
+
+class HeavyFlow : public dynamo::FlowBuilder
+{
+public:
+    using FlowBuilder::FlowBuilder;
+
+    virtual constexpr const char* name() const { return "HeavyFlow"; }
+
+    void build() override
+    {
+        emplace([](dynamo::AgentHandle agent)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+                std::lock_guard lock{ reasoning_order_mutex };
+                reasoning_order.emplace_back(agent.entity().name().c_str());
+            });
+    }
+};
+
 TEST_CASE("Basics") {
     using namespace dynamo;
     auto sim = Simulation();
@@ -99,10 +348,631 @@ TEST_CASE("Basics") {
         CHECK(percept.get<Decay>()->ttl);
         CHECK(percept.has<perceive>(radio));
         CHECK(arthur.entity().has<perceive>(percept));
+        CHECK(perceives(arthur.entity(), percept));
+        CHECK(perceives(arthur.entity(), radio.entity()));
+
+        auto bob = sim.agent("bob");
+        auto echo = sim.percept<Default>(arthur)
+                .perceived_by(bob)
+                .entity();
+        CHECK(perceives(echo, radio.entity()));
+        CHECK(perceives(bob.entity(), radio.entity()));
 
         sim.step(ttl); // To deplete decay cooldown
         sim.step(); // To delete entity
         CHECK(percept.is_alive() == false);
+        CHECK_FALSE(perceives(arthur.entity(), percept));
+        CHECK_FALSE(perceives(arthur.entity(), radio.entity()));
+        CHECK(perceives(echo, arthur.entity()));
+        CHECK_FALSE(perceives(echo, radio.entity()));
+        CHECK_FALSE(perceives(bob.entity(), radio.entity())); // Through echo, arthur no longer perceives it
+    }
+
+    SUBCASE("Attention"){
+        auto arthur = sim.agent("arthur");
+        arthur.set<Attention>({ 1 });
+        auto radio = sim.artefact("Radio");
+
+        salience<Vision>(sim.world(), [](flecs::entity) { return 10.0f; });
+        auto heard = sim.percept<Hearing>(radio).perceived_by(arthur).entity();
+        auto seen = sim.percept<Vision>(radio).perceived_by(arthur).entity();
+
+        sim.step();
+        auto attended = arthur.get<Attended>();
+        REQUIRE(attended != nullptr);
+        REQUIRE(attended->percepts.size() == 1);
+        CHECK(attended->percepts[0] == seen);
+        CHECK(attended->ignored == 1);
+        CHECK(heard.is_alive());
+    }
+
+    SUBCASE("Aggregated percepts"){
+        auto arthur = sim.agent("arthur");
+        auto radio = sim.artefact("Radio");
+
+        auto first = sim.aggregated_percept<Hearing>(radio, 1.0f).decay().perceived_by(arthur).entity();
+        sim.step(0.5f);
+        auto second = sim.aggregated_percept<Hearing>(radio, 1.0f).decay().perceived_by(arthur).entity();
+        CHECK(first == second);
+        CHECK(second.get<Occurrences>()->count == 2);
+
+        auto other = sim.aggregated_percept<Vision>(radio, 1.0f).entity();
+        CHECK(other != first);
+
+        sim.step(1.5f);
+        auto third = sim.aggregated_percept<Hearing>(radio, 1.0f).entity();
+        CHECK(third != first);
+    }
+
+    SUBCASE("Messaging"){
+        sim.world().import<module::Messaging>();
+        auto team = sim.world().entity("Team").add<type::Organisation>();
+        auto arthur = sim.agent("arthur").entity();
+        auto bob = sim.agent("bob").entity();
+        auto charlie = sim.agent("charlie").entity();
+        arthur.set<Mailbox>(Mailbox(4)).add<belongs_to>(team);
+        bob.set<Mailbox>(Mailbox(4)).add<belongs_to>(team);
+        charlie.set<Mailbox>(Mailbox(4));
+        sim.step(); // To rebuild subscriptions
+
+        auto payload = Payload::intern("Regroup");
+        CHECK(payload == Payload::intern("Regroup"));
+        CHECK(publish(charlie, team, payload) == 2);
+        CHECK(send(arthur, charlie, "Copy that"));
+
+        std::vector<Envelope> received{};
+        CHECK(receive(bob, [&received](Envelope&& envelope) { received.push_back(std::move(envelope)); }) == 1);
+        CHECK(received[0].sender == charlie.id());
+        CHECK(received[0].topic == team.id());
+        CHECK(received[0].payload.view() == "Regroup");
+        CHECK(receive(charlie, [](Envelope&& envelope) { CHECK(envelope.payload.view() == "Copy that"); }) == 1);
+        CHECK(receive(charlie, [](Envelope&&) {}) == 0);
+    }
+
+    SUBCASE("Action catalog"){
+        catalog<TagOne>(sim.world());
+        auto before = sim.action("Before").add<TagOne>().entity();
+        catalog<TagOne>(sim.world()); // Registering twice is a no-op
+        CHECK(actions<TagOne>(sim.world()).size() == 1);
+
+        auto after = sim.action("After").add<TagOne>().entity();
+        sim.action("Untagged");
+        auto listed = actions<TagOne>(sim.world());
+        CHECK(listed.size() == 2);
+        CHECK(std::find(listed.begin(), listed.end(), after) != listed.end());
+
+        before.remove<TagOne>();
+        listed = actions<TagOne>(sim.world());
+        REQUIRE(listed.size() == 1);
+        CHECK(listed[0] == after);
+        CHECK(actions<TagTwo>(sim.world()).empty());
+    }
+
+    SUBCASE("Current action"){
+        auto walk = sim.action("Walk").entity();
+        auto run = sim.action("Run").entity();
+        auto arthur = sim.agent("Arthur").entity();
+        auto bob = sim.agent("Bob").entity();
+        sim.step(1.f);
+
+        perform(arthur, walk);
+        perform(bob, walk);
+        CHECK(performers(walk).size() == 2);
+        CHECK(arthur.get<CurrentAction>()->start_time == doctest::Approx(1.f));
+
+        sim.step(1.f);
+        perform(arthur, walk); // Already performing it, start time is kept.
+        CHECK(arthur.get<CurrentAction>()->start_time == doctest::Approx(1.f));
+        const std::string type = arthur.type().str().c_str();
+        perform(arthur, run);
+        CHECK(type == arthur.type().str().c_str()); // No table move
+        REQUIRE(performers(walk).size() == 1);
+        CHECK(performers(walk)[0] == bob.id());
+        CHECK(performers(run).size() == 1);
+
+        bob.remove<CurrentAction>();
+        CHECK(performers(walk).empty());
+
+        arthur.get_mut<CurrentAction>()->progress = 0.5f;
+        perform(arthur, walk); // Switching resets progress.
+        CHECK(arthur.get<CurrentAction>()->progress == 0.f);
+
+        arthur.get_mut<CurrentAction>()->action = run.id(); // Bypass perform(...)
+        arthur.modified<CurrentAction>();
+        CHECK(performers(run).size() == 1);
+        CHECK(performers(walk).empty());
+    }
+
+    SUBCASE("Dynamics"){
+        struct Mood { float arousal {0.f}; };
+        sim.world().import<module::BasicStress>();
+        integrate<Mood, &Mood::arousal>(sim.world(), dynamics::Relaxation{ 1.f, 1.f });
+
+        auto arthur = sim.agent("Arthur").set<Stress>({ 2.f }).set<Mood>({}).entity();
+        sim.step(1.5f);
+        CHECK(arthur.get<Stress>()->value == doctest::Approx(0.5f));
+        CHECK(arthur.get<Mood>()->arousal == doctest::Approx(1.f - std::exp(-1.5f)));
+        sim.step(1.f);
+        CHECK(arthur.get<Stress>()->value == doctest::Approx(0.f)); // Clamped
+
+        auto calm = sim.world().prefab("Calm").set<Mood>({});
+        auto bob = sim.agent("Bob").entity().is_a(calm);
+        sim.step(1.f);
+        CHECK(bob.get<Mood>()->arousal == doctest::Approx(0.f)); // Shared with the prefab, not integrated.
+    }
+
+    SUBCASE("Multiple threads"){
+        auto threaded = Simulation(4);
+        auto radio = threaded.artefact("Radio");
+        auto arthur = threaded.agent("Arthur");
+        radio.entity()
+            .set<PeriodicEmitter, Message>({ 1.f })
+            .set<Targets>({ { arthur.entity() } });
+
+        std::vector<flecs::entity> percepts{};
+        for(int i = 0; i < 100; i++){
+            percepts.push_back(threaded.percept<Default>(radio).decay(0.5f).entity());
+        }
+        threaded.step(1.f);
+        threaded.step(1.f);
+        for(auto percept : percepts){
+            CHECK(!percept.is_alive());
+        }
+
+        int emitted = 0;
+        arthur.entity().each<perceive>([&emitted](flecs::entity percept) { emitted += percept.has<Hearing>(); });
+        CHECK(emitted > 0);
+        CHECK(perceives(arthur.entity(), radio.entity()));
+    }
+
+    SUBCASE("Jobs"){
+        struct Heat { float value {0.f}; };
+        auto heat = [](float delta_time, size_t count, Heat* heat) {
+            for(size_t i = 0; i < count; i++){
+                heat[i].value += delta_time;
+            }
+        };
+
+        auto e = sim.world().entity().set<Heat>({});
+        job<Heat>(sim.world(), "Heat", heat, true);
+        sim.step(0.5f);
+        CHECK(e.get<Heat>()->value == doctest::Approx(0.5f));
+
+        flecs::world world{}; // Without a simulation, jobs run inline.
+        world.import<module::Core>();
+        auto f = world.entity().set<Heat>({});
+        job<Heat>(world, "Heat", heat);
+        world.progress(0.5f);
+        CHECK(f.get<Heat>()->value == doctest::Approx(0.5f));
+    }
+
+    SUBCASE("Snapshots"){
+        struct Energy { int value {0}; };
+        struct Tired {};
+        snapshot<Energy>(sim.world());
+        snapshot<Tired>(sim.world());
+
+        auto arthur = sim.agent("Arthur").set<Energy>({ 10 }).entity();
+        auto handle = AgentHandle(arthur);
+        CHECK(handle.get<Energy>() == nullptr); // Nothing captured yet
+
+        sim.step();
+        REQUIRE(handle.get<Energy>());
+        CHECK(handle.get<Energy>()->value == 10);
+
+        arthur.set<Energy>({ 5 }).add<Tired>();
+        CHECK(handle.get<Energy>()->value == 10); // Flows read the state at the start of reasoning
+        CHECK(!handle.has<Tired>());
+
+        sim.step();
+        CHECK(handle.get<Energy>()->value == 5);
+        CHECK(handle.has<Tired>());
+        CHECK(handle.has<type::Agent>()); // Not registered, read from the world
+
+        auto radio = sim.artefact("Radio").entity().set<Energy>({ 1 });
+        sim.step();
+        CHECK(AgentHandle(radio).get<Energy>() == nullptr); // Only agents are captured
+        CHECK(handle.get<Energy>()->value == 5);
+
+        auto archetype = sim.agent_archetype("Energetic").set_shared<Energy>({ 20 });
+        auto bob = sim.agent(archetype, "Bob").entity();
+        sim.step();
+        REQUIRE(AgentHandle(bob).get<Energy>());
+        CHECK(AgentHandle(bob).get<Energy>()->value == 20); // Inherited from the archetype
+    }
+
+    SUBCASE("Step modes"){
+        sim.flow<TagFlow>();
+        auto archetype = sim.agent_archetype("Reasoning");
+        archetype.flow<TagFlow>({ true, 0.f });
+
+        auto sequential = sim.agent(archetype, "Sequential").entity();
+        sim.step();
+        CHECK(sequential.has<Reasoned>());
+        CHECK(sim.timings().total.count() >= sim.timings().progress.count());
+
+        sim.step_mode(StepMode::Pipelined);
+        auto pipelined = sim.agent(archetype, "Pipelined").entity();
+        sim.step();
+        CHECK(!pipelined.has<Reasoned>()); // Commands are applied one tick later
+        sim.step();
+        CHECK(pipelined.has<Reasoned>());
+
+        sim.step_mode(StepMode::Sequential);
+        CHECK(sim.commands_queue_size() == 0);
+    }
+
+    SUBCASE("Triggered flows"){
+        sim.flow<TagFlow>().on_percept<Hearing>();
+        auto archetype = sim.agent_archetype("Triggered");
+        archetype.flow<TagFlow>({ false });
+
+        auto arthur = sim.agent(archetype, "Arthur");
+        auto radio = sim.artefact("Radio");
+        sim.step();
+        CHECK(!arthur.entity().has<Reasoned>()); // Nothing happened
+        arthur.entity().children([](flecs::entity flow) {
+            CHECK(flow.has<Status>()); // Launching won't move the flow to another table
+        });
+
+        sim.percept<Smell>(radio).perceived_by(arthur);
+        sim.step();
+        CHECK(!arthur.entity().has<Reasoned>());
+
+        sim.percept<Hearing>(radio).perceived_by(arthur);
+        sim.step();
+        CHECK(arthur.entity().has<Reasoned>());
+
+        arthur.entity().remove<Reasoned>();
+        sim.signal<TagFlow>(arthur);
+        sim.step();
+        CHECK(arthur.entity().has<Reasoned>());
+    }
+
+    SUBCASE("Incremental processes"){
+        snapshot<Fatigue>(sim.world());
+        sim.strategy<strat::Random<int>>().behaviour("Fatigue",
+            [](AgentHandle agent) { return true; },
+            [](AgentHandle agent) { fatigue_computations++; return agent.get<Fatigue>()->value; }
+        );
+        sim.strategy<strat::Random<bool, int>>().behaviour("Rest",
+            [](AgentHandle agent) { return true; },
+            [](AgentHandle agent, const int& fatigue) { rest_computations++; return fatigue > 5; }
+        );
+        sim.flow<RestFlow>();
+        auto archetype = sim.agent_archetype("Resting");
+        archetype.flow<RestFlow>({ true, 0.f });
+        auto arthur = sim.agent(archetype, "Arthur").set<Fatigue>({ 3 }).entity();
+
+        sim.step();
+        CHECK(fatigue_computations == 1);
+        CHECK(rest_computations == 1);
+
+        arthur.set<Fatigue>({ 3 });
+        sim.step();
+        sim.step();
+        CHECK(fatigue_computations == 1); // Same value, nothing is computed
+        CHECK(rest_computations == 1);
+
+        arthur.set<Fatigue>({ 8 });
+        sim.step();
+        CHECK(fatigue_computations == 2);
+        CHECK(rest_computations == 2);
+
+        arthur.set<Fatigue>({ 9 });
+        sim.step();
+        sim.step();
+        CHECK(fatigue_computations == 3);
+        CHECK(rest_computations == 3);  // Its input changed, but not its output
+    }
+
+    SUBCASE("Memoized processes"){
+        auto single = Simulation(1); // Flows run one after the other, so only the first one misses.
+        single.strategy<strat::Random<int>>().behaviour("Plan",
+            [](AgentHandle agent) { return true; },
+            [](AgentHandle agent) { plan_computations++; return 42; }
+        );
+        single.flow<PlanFlow>();
+        auto archetype = single.agent_archetype("Planning");
+        archetype.flow<PlanFlow>({ true, 0.f });
+        single.agent(archetype, "Arthur");
+        single.agent(archetype, "Bob");
+        single.agent(archetype, "Charles");
+
+        single.step();
+        CHECK(plan_computations == 1);
+        single.step();
+        CHECK(plan_computations == 2); // Results are only shared during a tick
+
+        auto stats = single.world().get<Memoization>()->cache->stats(typeid(strat::Random<int>));
+        CHECK(stats.hits == 4);
+        CHECK(stats.misses == 2);
+        CHECK(stats.hit_rate() == doctest::Approx(4. / 6.));
+
+        // Same hash, different inputs : not shared.
+        MemoCache cache{};
+        using Key = std::tuple<int, size_t>;
+        cache.insert(typeid(int), 7, Key{ 1, 0 }, 10);
+        CHECK(cache.find<int, Key>(typeid(int), 7, Key{ 2, 0 }) == nullptr);
+        REQUIRE(cache.find<int, Key>(typeid(int), 7, Key{ 1, 0 }));
+        CHECK(*cache.find<int, Key>(typeid(int), 7, Key{ 1, 0 }) == 10);
+    }
+
+    SUBCASE("Conditional and composed processes"){
+        sim.strategy<strat::Random<int>>().behaviour("Fatigue",
+            [](AgentHandle agent) { return true; },
+            [](AgentHandle agent) { return agent.get<Fatigue>()->value; }
+        );
+        sim.strategy<strat::Random<int, int>>().behaviour("Gate",
+            [](AgentHandle agent) { return true; },
+            [](AgentHandle agent, const int& fatigue) { return fatigue > 5 ? 0 : 1; }
+        );
+        sim.flow<GateFlow>();
+        auto archetype = sim.agent_archetype("Gated");
+        archetype.flow<GateFlow>({ true, 0.f });
+        auto arthur = sim.agent(archetype, "Arthur").set<Fatigue>({ 8 }).entity();
+        auto bob = sim.agent(archetype, "Bob").set<Fatigue>({ 2 }).entity();
+
+        sim.step();
+        CHECK(arthur.has<Sleeping>());
+        CHECK(!arthur.has<Working>());
+        CHECK(!bob.has<Sleeping>());
+        CHECK(bob.has<Working>());
+
+        int conditionals = 0;
+        int modules = 0;
+        sim.world().each([&](flecs::entity e, const type::ProcessDetails& details) {
+            for (const auto& [_, process] : details.container)
+            {
+                if (process.type() == ProcessType::Conditional)
+                {
+                    CHECK(process.branches().size() == 2);
+                    conditionals++;
+                }
+                if (process.type() == ProcessType::Composed)
+                {
+                    REQUIRE(process.module());
+                    CHECK(std::string(process.module()->name()) == "FatigueModule");
+                    modules++;
+                }
+            }
+        });
+        CHECK(conditionals == 2);
+        CHECK(modules == 2);
+    }
+
+    SUBCASE("Task fusion"){
+        Strategies strategies;
+        strategies.add<strat::Random<int, int>>().behaviour("Double",
+            [](AgentHandle agent) { return true; },
+            [](AgentHandle agent, const int& value) { return value * 2; }
+        );
+        auto flow = ChainFlow(&strategies, AgentHandle(sim.agent("Arthur").entity()));
+        flow.build();
+        auto details = flow.process_details();
+        tf::Taskflow taskflow = std::move(flow);
+
+        CHECK(details.container.size() == 3); // Logical processes are kept
+        CHECK(details.graph->num_tasks() == 3);
+        CHECK(taskflow.num_tasks() == 1); // Static value removed, chain fused
+        size_t executed = 0;
+        taskflow.for_each_task([&executed](tf::Task task) { executed = task.hash_value(); });
+        for (const auto& [hash, process] : details.container)
+        {
+            if (process.type() == ProcessType::Simple)
+                CHECK(details.executed_task(hash) == executed);
+        }
+
+        tf::Executor executor(1);
+        executor.run(taskflow).wait();
+        CHECK(*flow.result == 8);
+    }
+
+    SUBCASE("Static flows"){
+        static_assert(NeedsFlow::order[0] == NeedsFlow::index<Tiredness>);
+        static_assert(NeedsFlow::order[1] == NeedsFlow::index<Needs>);
+        static_assert(!NeedsFlow::sequential); // Urge and Worry can run in parallel
+        static_assert(StaticFlow<Needs, Tiredness>::sequential);
+
+        Strategies strategies;
+        strategies.add<strat::Random<int>>().behaviour("Tiredness",
+            [](AgentHandle agent) { return true; },
+            [](AgentHandle agent) { return 3; }
+        );
+        strategies.add<strat::Random<int, int, int>>().behaviour("Needs",
+            [](AgentHandle agent) { return true; },
+            [](AgentHandle agent, const int& a, const int& b) { return a + b; }
+        );
+        strategies.add<strat::Random<bool, int>>().behaviour("Threshold",
+            [](AgentHandle agent) { return true; },
+            [](AgentHandle agent, const int& needs) { return needs > 5; }
+        );
+
+        auto agent = AgentHandle(sim.agent("Arthur").entity());
+        NeedsFlow::Frame frame{};
+        NeedsFlow::run(strategies, agent, frame);
+        CHECK(std::get<NeedsFlow::index<Needs>>(frame) == 6);
+        CHECK(std::get<NeedsFlow::index<Urge>>(frame));
+
+        auto flow = StaticNeedsFlow(&strategies, agent);
+        flow.build();
+        tf::Taskflow taskflow = std::move(flow);
+        CHECK(taskflow.num_tasks() == 3); // Tiredness and Needs are fused
+
+        tf::Executor executor(2);
+        executor.run(taskflow).wait();
+        CHECK(std::get<NeedsFlow::index<Worry>>(*flow.frame));
+    }
+
+    SUBCASE("Routines"){
+        listen<Hearing>(sim.world());
+        sim.flow<WaitingFlow>();
+        auto archetype = sim.agent_archetype("Waiting");
+        archetype.flow<WaitingFlow>({ true, 0.f });
+        auto arthur = sim.agent(archetype, "Arthur");
+        auto radio = sim.artefact("Radio");
+        auto scheduler = sim.world().get<Routines>()->scheduler;
+
+        sim.step();
+        CHECK(scheduler->size() == 1);
+        sim.step();
+        CHECK(!arthur.entity().has<Waited>());
+        CHECK(scheduler->size() == 1); // Launched again, but still waiting
+        sim.step();
+        CHECK(arthur.entity().has<Waited>());
+
+        sim.step();
+        CHECK(!arthur.entity().has<Alerted>());
+        sim.percept<Hearing>(radio).perceived_by(arthur);
+        sim.step();
+        CHECK(arthur.entity().has<Alerted>());
+    }
+
+    SUBCASE("Pipelined routines"){
+        sim.step_mode(StepMode::Pipelined);
+        sim.flow<WaitingFlow>();
+        auto archetype = sim.agent_archetype("Waiting");
+        archetype.flow<WaitingFlow>({ true, 0.f });
+        auto arthur = sim.agent(archetype, "Arthur").entity();
+
+        // ticks(...) is awaited on a worker while the world progresses : its scheduler comes from the routine's slot.
+        for (int i = 0; i < 8 && !arthur.has<Waited>(); i++)
+            sim.step();
+        CHECK(arthur.has<Waited>());
+        sim.step_mode(StepMode::Sequential);
+    }
+
+    SUBCASE("Failing routines"){
+        sim.flow<FailingFlow>();
+        auto archetype = sim.agent_archetype("Failing");
+        archetype.flow<FailingFlow>({ true, 0.f });
+        sim.agent(archetype, "Arthur");
+        auto scheduler = sim.world().get<Routines>()->scheduler;
+
+        sim.step();
+        CHECK(scheduler->failures().size() == 1);
+        sim.step();
+        CHECK(scheduler->failures().size() == 2); // Its slot was released, so it started again
+    }
+
+    SUBCASE("Reasoning budget"){
+        sim.strategy<strat::Random<int>>().behaviour("Deliberate",
+            [](AgentHandle agent) { return true; },
+            [](AgentHandle agent) { deliberations++; return 1; }
+        );
+        sim.flow<DeliberationFlow>();
+        auto archetype = sim.agent_archetype("Deliberating");
+        archetype.flow<DeliberationFlow>({ true, 0.f });
+        sim.agent(archetype, "Arthur");
+        sim.agent(archetype, "Bob");
+        sim.agent(archetype, "Charles");
+
+        sim.reasoning_budget(std::chrono::nanoseconds(1));
+        sim.step();
+        CHECK(deliberations == 0); // Out of time before any flow started
+        CHECK(sim.deferred_flows() == 3);
+
+        sim.reasoning_budget(std::chrono::seconds(10));
+        sim.step();
+        CHECK(deliberations == 3);
+        CHECK(sim.deferred_flows() == 0);
+    }
+
+    SUBCASE("Anytime processes"){
+        Strategies strategies;
+        strategies.add<strat::Random<int>>().behaviour("Deliberate",
+            [](AgentHandle agent) { return true; },
+            [](AgentHandle agent) { anytime_deliberations++; interrupted_deliberations += cancelled(); return cancelled() ? 0 : 1; }
+        );
+        auto agent = AgentHandle(sim.agent("Arthur").entity());
+        auto flow = DeliberationFlow(&strategies, agent);
+        flow.build();
+        tf::Taskflow taskflow = std::move(flow);
+        tf::Executor executor(1);
+
+        auto token = sim.world().get<ReasoningBudget>()->token;
+        token.cancel();
+        executor.run(taskflow).wait();
+        CHECK(anytime_deliberations == 1); // Computed once, giving up as soon as possible
+        CHECK(interrupted_deliberations == 1);
+
+        executor.run(taskflow).wait();
+        CHECK(anytime_deliberations == 1); // Keeps its previous output
+
+        token.reset();
+        executor.run(taskflow).wait();
+        CHECK(anytime_deliberations == 2);
+        CHECK(interrupted_deliberations == 1);
+    }
+
+    SUBCASE("Deadlines"){
+        sim.strategy<strat::Random<int>>().behaviour("Slow",
+            [](AgentHandle agent) { return true; },
+            [](AgentHandle agent) { slow_computations++; std::this_thread::sleep_for(std::chrono::milliseconds(200)); return 0; }
+        );
+        sim.flow<SlowFlow>().deadline(std::chrono::milliseconds(20), 2.f);
+        auto archetype = sim.agent_archetype("Slow");
+        archetype.flow<SlowFlow>({ true, 0.f });
+        auto arthur = sim.agent(archetype, "Arthur");
+        auto patient = sim.agent_archetype("Patient");
+        patient.flow<SlowFlow>({ true, 0.f, 1000.f }); // Its own deadline
+        sim.agent(patient, "Bob");
+
+        sim.step();
+        REQUIRE(sim.overruns().size() == 1);
+        const auto& overrun = sim.overruns().front();
+        CHECK(overrun.agent == arthur.entity().id());
+        CHECK(overrun.processes == "Slow");
+        CHECK(overrun.deadline.count() == doctest::Approx(20.));
+        CHECK(overrun.stalled); // Sleeping, not checking for cancellation
+
+        auto flow = flecs::entity(sim.world(), overrun.flow);
+        CHECK(flow.get<Cyclic>()->period == doctest::Approx(0.04f)); // Backed off from the deadline
+        CHECK(flow.has<Cooldown>());
+    }
+
+    SUBCASE("Priorities"){
+        auto single = Simulation(1); // Flows start in the order they are launched
+        single.flow<OrderFlow>();
+        auto archetype = single.agent_archetype("Ordered");
+        archetype.flow<OrderFlow>({ true, 0.f });
+        single.agent(archetype, "Arthur");
+        single.agent(archetype, "Bob");
+        single.agent(archetype, "Charles").entity().set<Priority>({ 5 });
+
+        single.step();
+        REQUIRE(reasoning_order.size() == 3);
+        CHECK(reasoning_order.front() == "Charles");
+
+        const auto& delays = single.queueing_delays();
+        CHECK(delays.begin()->first == 5);
+        CHECK(delays.at(5).count == 1);
+        CHECK(delays.at(0).count == 2);
+    }
+
+    SUBCASE("Critical path scheduling"){
+        auto single = Simulation(1);
+        single.critical_path_scheduling(true);
+        single.flow<OrderFlow>();
+        single.flow<HeavyFlow>();
+        auto light = single.agent_archetype("Light");
+        light.flow<OrderFlow>({ true, 0.f });
+        auto heavy = single.agent_archetype("Heavy");
+        heavy.flow<HeavyFlow>({ true, 0.f });
+        single.agent(light, "Arthur");
+        single.agent(heavy, "Bob");
+
+        single.step(); // Nothing measured yet
+        CHECK(single.critical_path<HeavyFlow>() > single.critical_path<OrderFlow>());
+        CHECK(single.critical_path<HeavyFlow>().count() >= 5.);
+
+        {
+            std::lock_guard lock{ reasoning_order_mutex };
+            reasoning_order.clear();
+        }
+        single.step();
+        REQUIRE(reasoning_order.size() == 2);
+        CHECK(reasoning_order.front() == "Bob"); // Longest flow first
     }
 
     SUBCASE("Queries"){